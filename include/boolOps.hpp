@@ -2,12 +2,18 @@
 
 // #include <glad/glad.h>
 // #include <GLFW/glfw3.h>
+#include <climits>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "hugePageBuffer.hpp"
+#include "lruCache.hpp"
 #include "shader.hpp"
 
 // Assuming VoxelizationParams is defined somewhere
@@ -21,6 +27,13 @@ struct VoxelObject {
   std::vector<GLuint> prefixSumData;
 };
 
+// Immutable, reference-counted voxel object. A finished result (carved workpiece,
+// loaded .bin) is handed to several consumers — viewer, background writer — by
+// sharing one buffer instead of deep-copying its transition arrays.
+using SharedVoxelObject = std::shared_ptr<const VoxelObject>;
+
+inline SharedVoxelObject makeSharedVoxelObject(VoxelObject&& obj) { return std::make_shared<const VoxelObject>(std::move(obj)); }
+
 class BoolOps {
  public:
   // BoolOps() = default;
@@ -29,6 +42,11 @@ class BoolOps {
 
   // Load a voxel object from file and store it internally
   bool load(const std::string& filename);
+  // Read a .bin voxel object into `obj` (not stored).
+  static bool loadObject(const std::string& filename, VoxelObject& obj);
+  // Read only the header of a .bin file: params and, if `transitions` is set, the
+  // number of compressedData entries (no transition data).
+  static bool loadParams(const std::string& filename, VoxelizationParams& params, size_t* transitions = nullptr);
   bool save(const std::string& filename, int idx = 0);
 
   // Accessor
@@ -49,13 +67,54 @@ class BoolOps {
   // void setupSubtractBuffers(const VoxelObject& obj1, const VoxelObject& obj2);
   // bool subtractGPU_sequence(const VoxelObject& obj1, const VoxelObject& obj2, glm::ivec3 offset);
 
-  // Subtract using GPU with flat buffers
-  bool subtractGPU_init(const VoxelObject& obj1, const VoxelObject& obj2);
+  // Subtract using GPU with flat buffers. subtractGPU_init() uploads the workpiece
+  // (object 0) once; tools live in a resident library (addTool / selectTool), so
+  // a tool change never touches the workpiece.
+  bool subtractGPU_init(const VoxelObject& obj1);
+
+  // Resident tool library. addTool() uploads a tool once under its T number
+  // (DEFAULT_TOOL for the tool used when a T number is not in the library) and
+  // selects it if no tool is active yet. selectTool() switches the active tool in
+  // O(1) (rebinds its buffers); for an unknown T number it selects the default
+  // tool and returns false.
+  static constexpr int DEFAULT_TOOL = -1;
+  bool addTool(VoxelObject&& tool, int number);
+  bool selectTool(int number);
+  bool hasTool(int number) const { return toolIndex.count(number) != 0; }
+  size_t toolCount() const { return tools.size(); }
+  // Active tool (nullptr if the library is empty) and its T number.
+  const VoxelObject* activeTool() const { return active ? &active->obj : nullptr; }
+  int activeToolNumber() const { return active ? active->number : DEFAULT_TOOL; }
+
   bool subtractGPU(glm::ivec3 offset);
+  // Stamp the tool at `count` offsets in order (one shader bind for the batch;
+  // repeats of the previous offset are skipped).
+  bool subtractGPU(const glm::ivec3* offsets, size_t count);
   // Subtract the volume swept by the tool along a linear segment (start -> start+displacement)
   // in a single dispatch. Requires subtractGPU_init() to have been called.
-  bool subtractSwept(glm::ivec3 startOffset, glm::ivec3 displacement);
+  // The swept envelope depends only on the tool and the displacement: once a
+  // displacement repeats, its envelope is kept as a stencil (LRU cache on the GPU)
+  // and later segments with that displacement only place and merge it.
+  // [firstSubstep, lastSubstep] limits the carve to part of the segment's substeps
+  // (clipped segments), without moving them.
+  bool subtractSwept(glm::ivec3 startOffset, glm::ivec3 displacement, int firstSubstep = 0, int lastSubstep = INT_MAX);
+  struct StencilStats {
+    long hits = 0;     // segments carved from a cached stencil
+    long misses = 0;   // segments whose envelope was evaluated by subtract_swept
+    long built = 0;    // stencils built (second sighting of a displacement)
+    long evicted = 0;  // stencils dropped to stay within the cache budget
+  };
+  const StencilStats& getStencilStats() const { return stencilStats; }
+  // GPU memory budget of the swept-stencil cache (memoryPlanner.hpp sizes it to the VRAM left over).
+  void setStencilCacheBytes(size_t bytes);
+  static size_t defaultStencilCacheBytes();
+  // Transition slots per column of the unpacked workpiece carved on the GPU.
+  static size_t flatTransitionsPerColumn();
+  void resetStencilStats() { stencilStats = StencilStats(); }
   void subtractGPU_copyback(VoxelObject& outData);
+  // Restore obj1 on the GPU to the state uploaded by subtractGPU_init(), so the next
+  // simulation can start without re-unpacking the workpiece.
+  void subtractGPU_reset();
 
  private:
   std::vector<VoxelObject> objects;
@@ -69,14 +128,29 @@ class BoolOps {
   // GLuint obj2Prefix;
 
   // Flat arrays
-  std::vector<GLuint> unpacked;
+  HugePageBuffer<GLuint> unpacked;  // flat obj1, kept for subtractGPU_reset(); filled by all cores (first touch)
   std::vector<GLuint> dataNum;
 
   // Flat buffers
   GLuint obj1_flat;        // Flat buffer for obj1 unpacked data
   GLuint obj1_dataNum;     // Buffer for valid data count of obj1
-  GLuint obj2_compressed;  // Flat buffer for obj2 unpacked data
-  GLuint obj2_prefix;      // Buffer for valid data count of obj2
+  // Resident tools. The active tool's buffers are bound at 2 (compressed) and 3 (prefix).
+  struct ToolSlot {
+    int number = DEFAULT_TOOL;  // T number
+    uint32_t id = 0;            // unique per upload (stencil cache key)
+    VoxelObject obj;
+    GLuint compressed = 0, prefix = 0;
+    // Swept envelope: intervals kept per swept column (1 for tools convex in Z,
+    // more for stepped/undercut ones) and every tool column as (lo, hi) pairs,
+    // for the CPU stencil build.
+    int sweptSlots = 1;
+    std::vector<GLint> intervals;
+    std::vector<uint32_t> intervalStart;  // per tool column, into intervals (+1 end)
+  };
+  std::vector<std::unique_ptr<ToolSlot>> tools;  // stable addresses for `active`
+  std::unordered_map<int, ToolSlot*> toolIndex;  // T number -> slot
+  ToolSlot* active = nullptr;
+  uint32_t nextToolId = 0;
 
   // OUT
   GLuint outCompressed;
@@ -94,6 +168,7 @@ class BoolOps {
   // Shader* shader2 = nullptr;      // Shader for GPU operations
   Shader* shader_flat = nullptr;     // Shader for flat per-step subtraction
   Shader* shader_swept = nullptr;    // Shader for swept-segment subtraction (Phase 2)
+  Shader* shader_stencil = nullptr;  // Swept subtraction from a cached stencil
   Shader* compressShader = nullptr;  // GPU compaction (unpacked flat -> compressed) for copyback
 
   // OpenGL utilities
@@ -102,6 +177,7 @@ class BoolOps {
   GLuint createBuffer(GLsizeiptr size, GLuint binding, GLenum usage);
   GLuint createBuffer(GLsizeiptr size, GLuint binding, GLenum usage, const GLuint* data);
   void loadBuffer(GLuint binding, const std::vector<GLuint>& data);
+  void loadBuffer(GLuint binding, const GLuint* data, size_t count);
   void deleteBuffer(GLuint binding);
   std::vector<GLuint> readBuffer(GLuint binding, size_t numElements);
   GLuint createAtomicCounter(GLuint binding);
@@ -109,5 +185,26 @@ class BoolOps {
   void zeroBuffer(GLuint binding);
   GLuint readAtomicCounter(GLuint binding);
 
-  bool unpackObject(const VoxelObject& obj, uint maxTransitions, std::vector<GLuint>& unpackedData, std::vector<GLuint>& validDataNum);
+  // Swept-envelope stencils, keyed by tool id + translate displacement.
+  struct StencilKey {
+    uint32_t tool;
+    glm::ivec3 delta;
+    bool operator==(const StencilKey& o) const { return tool == o.tool && delta == o.delta; }
+  };
+  struct StencilKeyHash {
+    size_t operator()(const StencilKey& k) const;
+  };
+  struct Stencil {
+    GLuint buffer = 0;  // (zMin, zMax) per column, relative to the segment start
+    int width = 0, height = 0;
+  };
+  LruCache<StencilKey, Stencil, StencilKeyHash> stencils;
+  std::unordered_set<StencilKey, StencilKeyHash> stencilSightings;  // displacements carved once, not cached yet
+  StencilStats stencilStats;
+  std::vector<GLint> stencilEnv;  // buildStencil() scratch: reused by every miss, only grows
+  static void prepareSweptTool(ToolSlot& slot);
+  void clearStencils();
+  bool buildStencil(glm::ivec3 tDelta, Stencil& out);
+
+  bool unpackObject(const VoxelObject& obj, uint maxTransitions, HugePageBuffer<GLuint>& unpackedData, std::vector<GLuint>& validDataNum);
 };
@@ -0,0 +1,40 @@
+#pragma once
+
+// =============================================================================
+//  cycleTime.hpp - Analytic machining-time estimate of a compiled toolpath.
+//
+//  Walks the compiled toolpath once (no wall clock, no threads): every segment
+//  takes length / feed (rapids at MachineLimits::rapidRate). With an
+//  acceleration limit each segment becomes a trapezoidal velocity profile:
+//  the speed through a corner is capped by the turn angle, a forward and a
+//  backward pass make every entry/exit speed reachable within the segment, and
+//  the time follows in closed form. Same input => same result, in O(n).
+// =============================================================================
+
+#include <cstddef>
+#include <vector>
+
+#include "toolpath.hpp"  // CompiledToolpath
+
+struct MachineLimits {
+  double rapidRate = 5000.0;   // G0 speed, mm/min
+  double maxFeed = 0.0;        // feed clamp, mm/min (0 = no clamp)
+  double acceleration = 0.0;   // mm/s^2 (0 = feed-limited only, instant speed changes)
+  double lengthScale = 1.0;    // mm per toolpath unit (e.g. voxel size for a voxel-space path)
+};
+
+struct CycleTimeReport {
+  double seconds = 0.0;       // total machining time
+  double cutSeconds = 0.0;    // G1/G2/G3
+  double rapidSeconds = 0.0;  // G0
+  double cutLength = 0.0;     // mm
+  double rapidLength = 0.0;   // mm
+  size_t segments = 0;
+  size_t zeroFeed = 0;        // cutting segments without a feed (not timed)
+};
+
+// Time to run `tp` (segments between consecutive entries, as carved). When
+// `segmentEnd` is given it receives the cumulative time at the end of every
+// entry (entry 0 = 0 s), e.g. for real-time playback.
+CycleTimeReport estimateCycleTime(const CompiledToolpath& tp, const MachineLimits& limits = MachineLimits(),
+                                  std::vector<double>* segmentEnd = nullptr);
@@ -1,15 +1,15 @@
 #pragma once
 
-#include <atomic>
+#include <chrono>
 #include <functional>
 #include <glm/glm.hpp>
-#include <map>
 #include <mutex>
 #include <string>
-#include <thread>
 #include <vector>
 
-enum class Plane { XY, ZX, YZ };
+#include "cycleTime.hpp"    // MachineLimits, CycleTimeReport
+#include "gcodeParser.hpp"  // GcodeParseStats
+#include "toolpath.hpp"     // CompiledToolpath, MotionMode, Plane, ToolpathOptions
 
 struct SimulationState {
   glm::vec3 position = glm::vec3(0.0f);
@@ -20,24 +20,26 @@ struct SimulationState {
   double speedFactor = 1.0;
 };
 
-struct GcodePoint {
-  glm::vec3 position = glm::vec3(0.0f);
-};
-
 class GCodeInterpreter {
  public:
   GCodeInterpreter();
   ~GCodeInterpreter();
 
-  bool loadFile(const std::string& filename);
+  // Compile the program (see toolpath.hpp). With a non-empty `cacheDir` the
+  // compiled toolpath is cached there, keyed by the program's content hash.
+  bool loadFile(const std::string& filename, const ToolpathOptions& opts = ToolpathOptions(), const std::string& cacheDir = "");
   bool checkFile() const;
+  const GcodeParseStats& getParseStats() const { return parseStats; }
+  bool loadedFromCache() const { return fromCache; }
 
   void setSpeedFactor(double factor);
+  // Machine limits used by cycleTime() and run() (see cycleTime.hpp).
+  void setMachineLimits(const MachineLimits& limits) { machineLimits = limits; }
+  // Analytic machining time of the compiled toolpath (no wall clock involved).
+  CycleTimeReport cycleTime() const { return estimateCycleTime(toolpath, machineLimits); }
+  // Real-time playback: starts a clock; getCurrentPosition() then follows the
+  // analytic time profile, scaled by the speed factor. No thread, no sleeping.
   void run();
-  void jog(float delta);
-  void beginJog();
-  void resetJog();
-  bool jogComplete() const;
   bool isRunning() const;
   void stop();
 
@@ -49,25 +51,33 @@ class GCodeInterpreter {
   double getCurrentSpindleSpeed() const;
   int getCurrentTool() const;
   Plane getCurrentPlane() const;
-  std::vector<GcodePoint> getToolpath();
+  // The compiled toolpath (built once by loadFile()).
+  const CompiledToolpath& getToolpath() const { return toolpath; }
+  // Map the compiled positions once (e.g. mm -> voxel offsets) before running or stepping a ToolpathCursor over it.
+  void applyTransform(const ToolpathTransform& xf) { transformToolpath(toolpath, xf); }
 
  private:
-  void executeCommand(const std::string& line);
-  void parseLine(const std::string& line, std::map<char, double>& params, std::string& cmd);
+  // Simulated program time of the playback (s); caller holds stateMutex.
+  double playbackTime() const;
+  // Move the state to program time `t` (s), or to the current playback time;
+  // caller holds stateMutex. The state is a view of the clock, hence const.
+  void seekPlayback(double t) const;
+  void syncPlayback() const {
+    if (running) seekPlayback(playbackTime());
+  }
 
-  std::vector<std::string> gcodeLines;
-  std::atomic<bool> running;
-  std::thread simulationThread;
-  std::vector<GcodePoint> toolpath;
-  bool previewMode = false;
+  CompiledToolpath toolpath;
+  GcodeParseStats parseStats;
+  bool fromCache = false;
   bool verbose = false;  // gate noisy per-command logging
+  MachineLimits machineLimits;
 
-  mutable std::mutex stateMutex;
-  SimulationState state;
+  // Playback clock: program time = anchorTime + (now - anchorWall) * speedFactor.
+  mutable bool running = false;  // cleared by seekPlayback() at the end of the program
+  std::vector<double> segmentEnd;  // cumulative time at every toolpath entry (run())
+  std::chrono::steady_clock::time_point anchorWall;
+  double anchorTime = 0.0;
 
-  // Jog state variables
-  size_t jogCurrentPoint = 0;
-  float jogAccumulatedDistance = 0.0f;
-  bool jogActive = false;
-  bool jogInitialized = false;
+  mutable std::mutex stateMutex;
+  mutable SimulationState state;
 };
@@ -0,0 +1,77 @@
+#pragma once
+
+// =============================================================================
+//  gcodeParser.hpp - Single-pass, parallel G-code parser.
+//
+//  Replaces the line-by-line GCodeInterpreter::parseLine() path (one
+//  std::string per line, an istringstream + substr + stod per token and a
+//  std::map<char,double> per line). The parser:
+//
+//    - memory-maps the program (MappedFile) and never copies a line;
+//    - reads every block into a fixed-size per-letter word table (26 slots +
+//      a presence bitmask, plus the G/M codes of the block) with from_chars;
+//    - splits the file into line-aligned chunks parsed in parallel. Each
+//      chunk keeps only the blocks that matter (motion, modal changes) in a
+//      compact form;
+//    - a sequential prefix pass replays the compact blocks (no text) to give
+//      every chunk its entry modal state; the chunks then count and emit
+//      their moves in parallel, in place, into the structure-of-arrays
+//      CompiledToolpath (toolpath.hpp).
+//
+//  The modal state machine tracks motion mode, plane, feed, tool, G90/G91,
+//  G20/G21, G90.1/G91.1, the G54..G59 work offsets (set with G10 L2/L20 P)
+//  and the G92 offset. Emitted positions are machine coordinates in
+//  millimetres (program * unit + work offset + G92; G53 blocks are machine
+//  coordinates already); feeds are in mm/min.
+//
+//  parseGcodeStream() is the streaming variant: it walks the program in
+//  line-aligned windows, each parsed from the exact modal state left by the
+//  previous one, and hands every window's moves to a sink as soon as they are
+//  ready (see toolpathStream.hpp). Memory is bounded by one window.
+//
+//  Arcs (G2/G3, I/J/K or R form, helical, in the G17/G18/G19 plane) are
+//  tessellated into the fewest chords whose sagitta stays within
+//  ToolpathOptions::arcTolerance; every chord is one toolpath entry.
+//
+//  Supported: G0/G1/G2/G3 (modal motion), G4, G17/G18/G19, G20/G21, G53,
+//  G54..G59, G80, G90/G91, G90.1/G91.1, G10 L2/L20, G92/G92.1/G92.2, T + M6,
+//  F, G28/G30 (their X/Y/Z are not moves), comments "( ... )" and "; ...",
+//  block delete '/' (ToolpathOptions::blockDelete), N line numbers and '%'.
+// =============================================================================
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+#include "parallel.hpp"
+#include "toolpath.hpp"  // CompiledToolpath, MotionMode, Plane, ToolpathOptions
+
+struct GcodeParseStats {
+  size_t bytes = 0;
+  size_t lines = 0;
+  size_t blocks = 0;       // blocks kept (motion or modal content)
+  size_t moves = 0;        // toolpath entries (arc chords included)
+  size_t arcs = 0;         // G2/G3 moves
+  size_t unsupported = 0;  // G codes ignored by the parser
+  unsigned chunks = 0;
+  double ms = 0.0;
+};
+
+// Parse the G-code program in [data, data + size) into `out` (one entry per
+// motion block: the tool moves from the previous entry's end point to this one).
+void parseGcodeBuffer(const char* data, size_t size, CompiledToolpath& out, const ToolpathOptions& opts = ToolpathOptions(),
+                      GcodeParseStats* stats = nullptr, unsigned workers = workerCount());
+
+// Receives one batch of consecutive moves. The sink may keep the batch by
+// swapping it with a spare one (the parser refills whatever it gets back).
+// Returning false stops the parse.
+using GcodeBatchSink = std::function<bool(CompiledToolpath& batch)>;
+
+// Parse [data, data + size) window by window (`windowBytes`, 0 = default),
+// calling `sink` with the moves of every window, in program order. `stats->chunks`
+// counts the windows.
+void parseGcodeStream(const char* data, size_t size, const GcodeBatchSink& sink, const ToolpathOptions& opts = ToolpathOptions(),
+                      GcodeParseStats* stats = nullptr, size_t windowBytes = 0);
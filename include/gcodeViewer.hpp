@@ -1,5 +1,6 @@
 #pragma once
 
+#include <climits>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
@@ -8,6 +9,7 @@
 #include "gcode.hpp"
 #include "gcode_params.hpp"
 #include "shader.hpp"
+#include "voxelResample.hpp"
 #include "voxelizer.hpp"
 
 // Enums
@@ -18,20 +20,61 @@ struct GLFWwindow;  // Forward declaration for GLFW window to avoid prbles with
 
 class GcodeViewer {
  public:
-  GcodeViewer(GLFWwindow* window, const std::vector<GcodePoint>& toolpath);
+  // `toolpath` is referenced, not copied: it must outlive the viewer.
+  GcodeViewer(GLFWwindow* window, const CompiledToolpath& toolpath);
   ~GcodeViewer();
 
   void pollEvents();
   void drawFrame();
   void carve(glm::vec3 pos);
+  // Stamp the tool at `count` positions (SoA, workpiece voxel offsets) in order,
+  // as one batch (see BoolOps::subtractGPU(const glm::ivec3*, size_t)).
+  void carveBatch(const float* x, const float* y, const float* z, size_t count);
   // Subtract the volume swept by the tool along the linear segment p0 -> p1 in one dispatch.
-  void carveSwept(glm::vec3 p0, glm::vec3 p1);
+  // The segment is first clipped to where the tool can touch the workpiece; returns
+  // false if nothing was left to carve.
+  bool carveSwept(glm::vec3 p0, glm::vec3 p1);
+  // Segments dropped / shortened by the clipping in carveSwept() since the last reset.
+  struct ClipStats {
+    long dropped = 0;
+    long clipped = 0;
+  };
+  const ClipStats& getClipStats() const { return clipStats; }
+  void resetClipStats() { clipStats = ClipStats(); }
+  // Swept-stencil cache hits / misses since the last reset (see BoolOps::subtractSwept).
+  const BoolOps::StencilStats& getStencilStats() const { return ops.getStencilStats(); }
+  void resetStencilStats() { ops.resetStencilStats(); }
+  void setStencilCacheBytes(size_t bytes) { ops.setStencilCacheBytes(bytes); }
   // Block until all queued GPU carving work has completed (for timing/sync).
   void finishGPU();
 
   // Set Voxelized Objects
   void setWorkpiece(std::string workpiecePath);
+  // Default tool (used for moves whose T number is not in the library).
   void setTool(std::string toolPath);
+  // Add tool T`number` to the resident tool library (after setWorkpiece).
+  bool addTool(int number, const std::string& toolPath);
+  // Tools added from now on are resampled to `voxelSize` (the stock's, per axis)
+  // when theirs differs, through the resampling cache in `cacheDir` (voxelResample.hpp).
+  void setToolVoxelSize(const glm::vec3& voxelSize, ResampleMode mode, const std::string& cacheDir) {
+    toolVoxelSize = voxelSize;
+    toolResample = mode;
+    toolCacheDir = cacheDir;
+  }
+  // Make T`number` the carving tool (O(1), the workpiece is untouched); a repeat
+  // of the current selection is free. Returns false if T`number` is not in the
+  // library (the default tool carves instead).
+  bool selectTool(int number);
+  // Positions are the tool tip (--units mm) instead of the tool-grid centre: every
+  // carve lifts the active tool by half its own height, so tools of any height
+  // cut at the programmed Z after a tool change.
+  void setToolTipAtZ(bool on) { toolTipAtZ = on; }
+  // Tool selections that changed the tool since the last reset.
+  long getToolChanges() const { return toolChanges; }
+  void resetToolChanges() {
+    toolChanges = 0;
+    selectedTool = INT_MIN;
+  }
 
   void setToolPosition(const glm::vec3& pos);
   void setProjectionType(ProjectionType type) { projectionType = type; };
@@ -40,13 +83,34 @@ class GcodeViewer {
     // Copy back the voxelized workpiece data after carving
     ops.subtractGPU_copyback(ops.getObjects()[0]);  // Copy back from GPU to CPU
   }
-  VoxelObject getWorkpiece() const {
+  // Read-only view of the workpiece (object 0); use takeWorkpiece() to keep it.
+  const VoxelObject& getWorkpiece() const {
     if (ops.getObjects().empty()) {
       throw std::runtime_error("No workpiece voxel object loaded.");
     }
     return ops.getObjects()[0];  // Return the first object (workpiece)
   }
 
+  // Move the carved workpiece (object 0) out of the viewer, e.g. to hand it to a
+  // ResultWriter. Params are kept, so resetWorkpiece() + carving can run again.
+  // Call after copyBack() so the CPU-side data is populated.
+  VoxelObject takeWorkpiece() {
+    if (ops.getObjects().empty()) {
+      throw std::runtime_error("No workpiece voxel object loaded.");
+    }
+    VoxelObject& wp = ops.getObjects()[0];
+    VoxelObject out;
+    out.params = wp.params;
+    out.compressedData = std::move(wp.compressedData);
+    out.prefixSumData = std::move(wp.prefixSumData);
+    wp.compressedData.clear();
+    wp.prefixSumData.clear();
+    return out;
+  }
+
+  // Restore the uncarved workpiece on the GPU (start of the next simulation).
+  void resetWorkpiece() { ops.subtractGPU_reset(); }
+
   // Save the carved workpiece (object 0) to a .bin voxel file.
   // Call after copyBack() so the CPU-side data is populated.
   bool saveWorkpiece(const std::string& path) { return ops.save(path, 0); }
@@ -63,6 +127,9 @@ class GcodeViewer {
 
   GLFWwindow* window = nullptr;
   glm::vec3 toolPosition;
+  glm::vec3 toolVoxelSize = glm::vec3(0.0f);  // 0 = tools are used at their own voxel size
+  ResampleMode toolResample = ResampleMode::NEAREST;
+  std::string toolCacheDir;
   glm::mat4 projection, view;
   ProjectionType projectionType = ProjectionType::ORTHOGRAPHIC;  // Default to orthographic projection
 
@@ -104,7 +171,7 @@ class GcodeViewer {
   void drawAxes();
 
   // Toolpath
-  std::vector<GcodePoint> path;
+  const CompiledToolpath& path;
   unsigned int pathVAO = 0, pathVBO = 0;
   size_t pathVertexCount = 0;
   // void setupBuffers();
@@ -157,4 +224,10 @@ class GcodeViewer {
   void initToolVO(const std::string& path);
 
   long carvingCounter = 0;  // Counter for carving operations
+  std::vector<glm::ivec3> stampOffsets;  // carveBatch() scratch
+  ClipStats clipStats;
+  int selectedTool = INT_MIN;  // last selectTool() argument (INT_MIN: none yet)
+  bool toolTipAtZ = false;
+  int tipLift() const;  // voxels the active tool is lifted by (0 unless toolTipAtZ)
+  long toolChanges = 0;
 };
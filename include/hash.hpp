@@ -0,0 +1,21 @@
+#pragma once
+
+// =============================================================================
+//  hash.hpp - FNV-1a 64-bit hash (result checksums, content-addressed caches).
+//
+//  Header-only (same style as utils.hpp / cli.hpp).
+// =============================================================================
+
+#include <cstddef>
+#include <cstdint>
+
+// FNV-1a 64-bit hash, chainable through `seed`.
+inline uint64_t fnv1a64(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ULL) {
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  uint64_t h = seed;
+  for (size_t i = 0; i < size; ++i) {
+    h ^= p[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+// =============================================================================
+//  hugePageBuffer.hpp - Large aligned buffers for hot voxel data, mapped on
+//  huge pages and faulted in by the threads that fill them.
+//
+//  std::vector value-initializes: resize() / assign() zero every element on the
+//  calling thread, so the flat workpiece (32 slots per column, 128 MB at 1024²)
+//  used to be faulted in by one thread on 4 KB pages: one TLB entry per 1024
+//  transitions in the memory-bound merge, and on a 2-socket machine every page
+//  on the caller's NUMA node. HugePageBuffer maps its memory without touching it:
+//
+//    - the mapping is 2 MB aligned and advised MADV_HUGEPAGE (transparent huge
+//      pages); after useExplicitHugePages(true) it is first tried on explicit
+//      huge pages (MAP_HUGETLB, reserved in /proc/sys/vm/nr_hugepages), falling
+//      back to transparent ones when none are left;
+//    - pages are faulted in by whichever thread writes them first: fill the
+//      buffer with parallelFor over contiguous ranges and every worker's range
+//      lands on that worker's NUMA node (first touch).
+//
+//  Contents are unspecified until written. Move-only; T must be trivially
+//  copyable. Other platforms get an aligned operator new.
+//
+//  Header-only (same style as parallel.hpp).
+// =============================================================================
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#define HUGE_PAGE_BYTES (size_t(2) << 20)
+
+// Process-wide: try explicit (hugetlbfs) pages before transparent ones.
+inline std::atomic<bool>& explicitHugePages() {
+  static std::atomic<bool> enabled{false};
+  return enabled;
+}
+inline void useExplicitHugePages(bool enabled) { explicitHugePages() = enabled; }
+
+template <typename T>
+class HugePageBuffer {
+  static_assert(std::is_trivially_copyable<T>::value, "HugePageBuffer holds plain data only");
+
+ public:
+  HugePageBuffer() = default;
+  explicit HugePageBuffer(size_t n) { allocate(n); }
+  ~HugePageBuffer() { release(); }
+
+  HugePageBuffer(const HugePageBuffer&) = delete;
+  HugePageBuffer& operator=(const HugePageBuffer&) = delete;
+  HugePageBuffer(HugePageBuffer&& o) noexcept { swap(o); }
+  HugePageBuffer& operator=(HugePageBuffer&& o) noexcept {
+    if (this != &o) {
+      release();
+      swap(o);
+    }
+    return *this;
+  }
+
+  // Drop the current contents and map room for `n` elements, untouched.
+  void allocate(size_t n) {
+    release();
+    if (n == 0) return;
+    const size_t want = n * sizeof(T);
+#ifdef __linux__
+    const size_t rounded = (want + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+    void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (explicitHugePages()) {
+      p = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (p != MAP_FAILED) explicitPages = true;
+    }
+#endif
+    if (p == MAP_FAILED) {
+      // Over-map by one huge page and trim, so the region starts on a 2 MB boundary.
+      char* raw = static_cast<char*>(mmap(nullptr, rounded + HUGE_PAGE_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+      if (raw == MAP_FAILED) throw std::bad_alloc();
+      const size_t head = (HUGE_PAGE_BYTES - reinterpret_cast<size_t>(raw) % HUGE_PAGE_BYTES) % HUGE_PAGE_BYTES;
+      if (head) munmap(raw, head);
+      if (HUGE_PAGE_BYTES - head) munmap(raw + head + rounded, HUGE_PAGE_BYTES - head);
+      p = raw + head;
+#ifdef MADV_HUGEPAGE
+      madvise(p, rounded, MADV_HUGEPAGE);  // a hint: the kernel may still use 4 KB pages
+#endif
+    }
+    ptr = static_cast<T*>(p);
+    bytes = rounded;
+#else
+    ptr = static_cast<T*>(::operator new(want, std::align_val_t(HUGE_PAGE_BYTES)));
+    bytes = want;
+#endif
+    count = n;
+  }
+
+  void clear() { release(); }
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  // Whether the mapping sits on explicit huge pages (else transparent ones, if the kernel grants them).
+  bool onExplicitHugePages() const { return explicitPages; }
+
+  T* data() { return ptr; }
+  const T* data() const { return ptr; }
+  T& operator[](size_t i) { return ptr[i]; }
+  const T& operator[](size_t i) const { return ptr[i]; }
+  T* begin() { return ptr; }
+  T* end() { return ptr + count; }
+  const T* begin() const { return ptr; }
+  const T* end() const { return ptr + count; }
+
+ private:
+  void release() {
+    if (!ptr) return;
+#ifdef __linux__
+    munmap(ptr, bytes);
+#else
+    ::operator delete(ptr, std::align_val_t(HUGE_PAGE_BYTES));
+#endif
+    ptr = nullptr;
+    count = bytes = 0;
+    explicitPages = false;
+  }
+  void swap(HugePageBuffer& o) noexcept {
+    std::swap(ptr, o.ptr);
+    std::swap(count, o.count);
+    std::swap(bytes, o.bytes);
+    std::swap(explicitPages, o.explicitPages);
+  }
+
+  T* ptr = nullptr;
+  size_t count = 0;
+  size_t bytes = 0;
+  bool explicitPages = false;
+};
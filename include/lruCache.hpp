@@ -0,0 +1,89 @@
+#pragma once
+
+// =============================================================================
+//  lruCache.hpp - Cost-bounded least-recently-used cache.
+//
+//  Entries are kept in recency order in a list indexed by a hash map; find()
+//  moves a hit to the front, insert() evicts from the back until the total
+//  cost (e.g. bytes) fits the budget. Evicted values are handed to a callback
+//  so owners of external resources (GL buffers) can release them.
+//
+//  Header-only (same style as parallel.hpp).
+// =============================================================================
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+template <typename K, typename V, typename Hash = std::hash<K>>
+class LruCache {
+ public:
+  explicit LruCache(size_t maxCost) : maxCost(maxCost) {}
+
+  size_t size() const { return index.size(); }
+  size_t cost() const { return totalCost; }
+  size_t capacity() const { return maxCost; }
+
+  // Value for `key` (now the most recently used), or nullptr.
+  V* find(const K& key) {
+    auto it = index.find(key);
+    if (it == index.end()) return nullptr;
+    entries.splice(entries.begin(), entries, it->second);
+    return &it->second->value;
+  }
+
+  // Insert `value` as the most recently used entry, then evict least recently
+  // used entries (calling onEvict(value) on each) until the cost fits. An entry
+  // costing more than the whole budget is rejected (onEvict is called on it).
+  // `key` must not be present.
+  template <typename OnEvict>
+  void insert(const K& key, V value, size_t cost, OnEvict&& onEvict) {
+    if (cost > maxCost) {
+      onEvict(value);
+      return;
+    }
+    entries.push_front(Entry{key, std::move(value), cost});
+    index[key] = entries.begin();
+    totalCost += cost;
+    while (totalCost > maxCost) {
+      Entry& victim = entries.back();
+      onEvict(victim.value);
+      totalCost -= victim.cost;
+      index.erase(victim.key);
+      entries.pop_back();
+    }
+  }
+
+  // Change the budget, evicting least recently used entries until the cost fits.
+  template <typename OnEvict>
+  void setCapacity(size_t newMaxCost, OnEvict&& onEvict) {
+    maxCost = newMaxCost;
+    while (totalCost > maxCost) {
+      Entry& victim = entries.back();
+      onEvict(victim.value);
+      totalCost -= victim.cost;
+      index.erase(victim.key);
+      entries.pop_back();
+    }
+  }
+
+  template <typename OnEvict>
+  void clear(OnEvict&& onEvict) {
+    for (Entry& e : entries) onEvict(e.value);
+    entries.clear();
+    index.clear();
+    totalCost = 0;
+  }
+
+ private:
+  struct Entry {
+    K key;
+    V value;
+    size_t cost;
+  };
+  std::list<Entry> entries;  // most recently used first
+  std::unordered_map<K, typename std::list<Entry>::iterator, Hash> index;
+  size_t maxCost;
+  size_t totalCost = 0;
+};
@@ -14,8 +14,23 @@
 #define GCODE_PATH "gcode/square_600.gcode"                    // simulate --gcode
 #define DEFAULT_WORKPIECE_BIN "test/workpiece_100_100_50.bin"  // simulate --workpiece
 #define DEFAULT_TOOL_BIN "test/hemispheric_mill_10.bin"        // simulate --tool
+#define ARC_TOLERANCE 0.25f                                    // G2/G3 max chord error, voxels (simulate --arc-tol)
+#define DEFAULT_UNITS "voxel"                                  // G-code units: mm | voxel (simulate --units)
+#define SIMPLIFY_TOLERANCE 0.25f                               // max toolpath simplification error, voxels (simulate --simplify)
+#define TOOLPATH_CACHE_DIR ".autocam_cache/toolpaths"          // compiled G-code cache (simulate --no-cache disables it)
+#define TOOL_CACHE_DIR ".autocam_cache/tools"                  // resampled tools (simulate --no-cache disables it)
+#define DEFAULT_RESAMPLE "nearest"                             // tool resampling to the stock voxel size: nearest | conservative | off
+#define STAMP_BATCH 4096                                       // legacy stamping: positions per cursor batch
+
+// --- Cycle-time defaults ----------------------------------------------------
+#define RAPID_RATE 5000.0   // G0 speed, mm/min (cycletime/simulate --rapid)
+#define MACHINE_ACCEL 0.0   // axis acceleration, mm/s^2; 0 = feed-limited only (cycletime/simulate --accel)
 
 // --- Voxelization defaults --------------------------------------------------
 #define RESOLUTION 0.1            // voxel size in object units, e.g. mm (voxelize --res)
 #define DEFAULT_MEM_MB 512        // GPU memory budget in MB (voxelize --mem-mb)
+#define DEFAULT_VOXELIZER_BACKEND "gpu"  // gpu | twopass | cpu (voxelize --backend)
+#define DEFAULT_TILE_PX 4096      // max XY tile of a GPU voxelization, px (voxelize --tile)
+#define DEFAULT_ZSUB 1            // Z slices per XY voxel: fixed-point Z transitions (voxelize/generate --zsub)
+#define DEFAULT_GENERATE_BIN "test/generated.bin"  // generate --out
 #define WHITE glm::vec3(1.0f, 1.0f, 1.0f)
@@ -0,0 +1,63 @@
+#pragma once
+
+// =============================================================================
+//  mappedFile.hpp - Read-only memory-mapped file (RAII, POSIX mmap).
+//
+//  Input parsers (STL, G-code) read the whole file anyway: mapping it avoids
+//  the ifstream copy into a std::string, and lets worker threads scan disjoint
+//  ranges of the same buffer directly.
+//
+//  Header-only (same style as utils.hpp / cli.hpp).
+// =============================================================================
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path) {
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Failed to open file: " + path);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Failed to stat file: " + path);
+    }
+    len = (size_t)st.st_size;
+
+    if (len > 0) {
+      void* p = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Failed to map file: " + path);
+      }
+      ::madvise(p, len, MADV_SEQUENTIAL);
+      ptr = static_cast<const char*>(p);
+    }
+  }
+
+  ~MappedFile() {
+    if (ptr) ::munmap(const_cast<char*>(ptr), len);
+    if (fd >= 0) ::close(fd);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* data() const { return ptr; }
+  size_t size() const { return len; }
+  const char* begin() const { return ptr; }
+  const char* end() const { return ptr + len; }
+
+ private:
+  int fd = -1;
+  const char* ptr = nullptr;
+  size_t len = 0;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+// =============================================================================
+//  memoryPlanner.hpp - Memory plan of a voxelization or a simulation, computed
+//  before anything is allocated.
+//
+//  The GPU voxelizer used to size its slice blocks from its own estimate
+//  (estimateMemoryUsageBytes) and nothing else was budgeted: the unpacked
+//  workpiece, the tools, the stencil cache, the readback buffers and the
+//  results waiting for the writer only showed up as a failed allocation in the
+//  middle of a run. The planner models every stage as byte counts derived from
+//  the grid sizes (no GL calls, no allocation probing, so the same plan comes
+//  out on every machine), then picks the knobs that make the run fit a RAM and
+//  a VRAM budget and reports the expected peak of each pool:
+//
+//    voxelize  XY tile, slices per block (GPU) or CPU worker threads;
+//    simulate  swept-stencil cache size, result writer queue depth.
+//
+//  Stages are either resident (held for the whole run) or belong to a phase
+//  (one tile, the readback, ...); the peak of a pool is its resident bytes plus
+//  its most expensive phase. Sizes that depend on the data (transitions of a
+//  result still to be computed) are estimates and are marked as such.
+// =============================================================================
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "parallel.hpp"
+#include "voxelizer.hpp"
+
+enum class MemoryPool { RAM, VRAM };
+
+struct MemoryItem {
+  std::string stage;
+  MemoryPool pool = MemoryPool::RAM;
+  size_t bytes = 0;
+  std::string phase;      // empty: resident for the whole run
+  bool estimate = false;  // data dependent (not an exact size)
+};
+
+// Budgets in bytes; 0 means unlimited.
+struct MemoryBudget {
+  size_t ramBytes = 0;
+  size_t vramBytes = 0;
+  unsigned maxWorkers = workerCount();
+};
+
+struct MemoryPlan {
+  std::vector<MemoryItem> items;
+  size_t peakRam = 0, peakVram = 0;
+  bool fitsRam = true, fitsVram = true;
+
+  // Voxelization choices.
+  glm::ivec2 tile = glm::ivec2(0);
+  int slicesPerBlock = 1;
+  unsigned workers = 1;
+  // Simulation choices.
+  size_t stencilCacheBytes = 0;
+  size_t writerQueue = 2;
+
+  bool fits() const { return fitsRam && fitsVram; }
+  void add(const std::string& stage, MemoryPool pool, size_t bytes, const std::string& phase = "", bool estimate = false);
+  // Peaks of both pools (resident + most expensive phase) and the budget checks.
+  void finish(const MemoryBudget& budget);
+};
+
+// Compiled moves a G-code file of `gcodeBytes` is expected to hold (estimate).
+size_t estimateToolpathMoves(size_t gcodeBytes);
+
+// Plan a voxelization of a mesh with `vertexCount` vertices and `triangleCount`
+// triangles on the grid of `params` (resolutionXYZ set, maxTransitionsPerZColumn
+// as configured). The VRAM budget replaces params.maxMemoryBudgetBytes when set.
+// Chooses tile and slicesPerBlock (GPU backends) or workers (CPU backend).
+MemoryPlan planVoxelization(const VoxelizationParams& params, VoxelizerBackend backend, size_t vertexCount, size_t triangleCount, int maxTilePx,
+                            const MemoryBudget& budget);
+
+// Everything a simulation holds: the stock and the tools (params at the carving
+// voxel size, transitions), the compiled toolpath and what happens to results.
+struct SimulationShape {
+  VoxelizationParams stock;
+  size_t stockTransitions = 0;
+  std::vector<std::pair<VoxelizationParams, size_t>> tools;
+  size_t toolpathMoves = 0;  // moves held in memory, estimated (0 when streamed)
+  bool saveOut = false;
+  bool viewer = true;
+};
+
+// Plan a simulation: chooses the stencil cache size (VRAM left over, at most the
+// built-in default) and the writer queue depth (RAM left over, 1..4 results).
+MemoryPlan planSimulation(const SimulationShape& shape, const MemoryBudget& budget);
+
+// Table of the plan: one line per stage, then the peaks against the budgets.
+void printMemoryPlan(const MemoryPlan& plan, const MemoryBudget& budget, std::ostream& os);
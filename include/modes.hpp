@@ -14,11 +14,24 @@
 // voxelize: STL mesh -> voxelize -> save .bin voxel object.
 int runVoxelize(const CliArgs& args);
 
+// voxelize-batch: a directory / list of meshes -> .bin files + CSV manifest,
+// with one OpenGL context for all of them (or the CPU voxelizer).
+int runVoxelizeBatch(const CliArgs& args);
+
+// generate: analytic primitives (boxes, cylinders, cutters) + CSG -> .bin voxel object.
+int runGenerate(const CliArgs& args);
+
+// resample: .bin voxel object -> same object at another voxel size (no re-voxelization).
+int runResample(const CliArgs& args);
+
 // simulate: carve a workpiece along a G-code toolpath with a tool, then view.
 int runSimulate(const CliArgs& args);
 
 // view: load a .bin voxel object and show it with the raymarching viewer.
 int runView(const CliArgs& args);
 
+// cycletime: analytic machining time of a G-code program (no carving, no GPU).
+int runCycleTime(const CliArgs& args);
+
 // Print top-level usage/help.
 void printUsage();
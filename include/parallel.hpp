@@ -0,0 +1,75 @@
+#pragma once
+
+// =============================================================================
+//  parallel.hpp - Tiny std::thread helpers for CPU-side data-parallel loops.
+//
+//  parallelFor(n, fn) splits [0, n) into one contiguous range per worker and
+//  calls fn(begin, end, worker) on each range. Contiguous ranges keep every
+//  worker on its own slice of the output (no false sharing, deterministic
+//  layout), and the calling thread runs the last range itself.
+//  parallelExclusiveScan(data, n) is the matching in-place prefix sum (column
+//  counts -> prefixSumData offsets when packing a voxel object).
+//
+//  Header-only (same style as utils.hpp / cli.hpp).
+// =============================================================================
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Number of workers to use for CPU loops (at least 1).
+inline unsigned workerCount() {
+  unsigned n = std::thread::hardware_concurrency();
+  return n > 0 ? n : 1;
+}
+
+// Run fn(begin, end, worker) over [0, n) split into at most `workers` ranges of
+// at least `minChunk` items. Returns the number of ranges actually used.
+template <typename Fn>
+unsigned parallelFor(size_t n, Fn&& fn, unsigned workers = workerCount(), size_t minChunk = 1) {
+  if (n == 0) return 0;
+  size_t maxWorkers = std::max<size_t>(1, n / std::max<size_t>(1, minChunk));
+  unsigned w = (unsigned)std::min<size_t>(std::max(1u, workers), maxWorkers);
+  size_t chunk = (n + w - 1) / w;
+
+  std::vector<std::thread> threads;
+  threads.reserve(w - 1);
+  for (unsigned t = 0; t + 1 < w; ++t) {
+    size_t b = t * chunk, e = std::min(n, b + chunk);
+    threads.emplace_back([&fn, b, e, t] { fn(b, e, t); });
+  }
+  size_t b = (size_t)(w - 1) * chunk;
+  fn(std::min(b, n), n, w - 1);
+  for (auto& th : threads) th.join();
+  return w;
+}
+
+// In-place exclusive prefix sum of `data[0..n)` split across `workers`: every
+// worker sums its range, the range totals are scanned, then every worker
+// rewrites its range from its offset. Returns the total of all elements.
+template <typename T>
+size_t parallelExclusiveScan(T* data, size_t n, unsigned workers = workerCount(), size_t minChunk = 1 << 16) {
+  std::vector<size_t> sums(std::max(1u, workers) + 1, 0);
+  const unsigned used = parallelFor(
+      n,
+      [&](size_t b, size_t e, unsigned w) {
+        size_t s = 0;
+        for (size_t i = b; i < e; ++i) s += data[i];
+        sums[w + 1] = s;
+      },
+      workers, minChunk);
+  for (unsigned w = 0; w < used; ++w) sums[w + 1] += sums[w];
+  parallelFor(
+      n,
+      [&](size_t b, size_t e, unsigned w) {
+        size_t running = sums[w];
+        for (size_t i = b; i < e; ++i) {
+          const T c = data[i];
+          data[i] = (T)running;
+          running += c;
+        }
+      },
+      workers, minChunk);
+  return sums[used];
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+// =============================================================================
+//  resultWriter.hpp - Background writer for carved / voxelized results.
+//
+//  Saving a result used to run on the caller's thread (GcodeViewer::saveWorkpiece
+//  -> BoolOps::save), so every `--out` stalled the next simulation until the
+//  file hit the disk. ResultWriter moves that work to a dedicated I/O thread:
+//
+//    - submit() TAKES OWNERSHIP of the result buffers (moved, never copied), or
+//      shares them when the result is also needed elsewhere (SharedVoxelObject);
+//    - the I/O thread encodes the .bin image, checksums it (FNV-1a 64) and
+//      writes it to "<path>.tmp", then renames it over <path> atomically, so a
+//      reader never sees a half-written file;
+//    - the queue is bounded: submit() blocks when `maxQueued` results are
+//      already pending, which caps the memory held by in-flight results.
+//
+//  The on-disk layout is the same one BoolOps::load() reads:
+//    VoxelizationParams | VoxelFileTag | size_t dataSize | size_t prefixSize | data | prefix
+// =============================================================================
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boolOps.hpp"  // VoxelObject
+#include "hash.hpp"
+
+// Write `obj` to `path` through a temporary file + atomic rename. If `checksum`
+// is not null it receives the FNV-1a 64 hash of the bytes written.
+bool writeVoxelObject(const VoxelObject& obj, const std::string& path, uint64_t* checksum = nullptr);
+
+class ResultWriter {
+ public:
+  struct Record {
+    std::string path;
+    uint64_t checksum = 0;
+    size_t bytes = 0;
+    double writeMs = 0.0;
+    bool ok = false;
+  };
+
+  explicit ResultWriter(size_t maxQueued = 2);
+  ~ResultWriter();  // drains the queue, then joins the I/O thread
+
+  ResultWriter(const ResultWriter&) = delete;
+  ResultWriter& operator=(const ResultWriter&) = delete;
+
+  // Queue `obj` for writing to `path`. Blocks while the queue is full.
+  void submit(VoxelObject&& obj, const std::string& path);
+  void submit(SharedVoxelObject obj, const std::string& path);
+
+  // Block until every submitted result has been written (or has failed).
+  void flush();
+
+  // Completed writes, in submission order. Call after flush().
+  std::vector<Record> records() const;
+  size_t failedCount() const;
+
+ private:
+  struct Job {
+    SharedVoxelObject obj;
+    std::string path;
+  };
+
+  void workerLoop();
+
+  const size_t maxQueued;
+  std::deque<Job> queue;
+  std::vector<Record> done;
+  size_t inFlight = 0;  // queued + being written
+  bool stopping = false;
+
+  mutable std::mutex mtx;
+  std::condition_variable cvWork;   // worker waits for jobs
+  std::condition_variable cvSpace;  // submit() waits for queue space
+  std::condition_variable cvIdle;   // flush() waits for inFlight == 0
+  std::thread worker;
+};
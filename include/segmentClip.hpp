@@ -0,0 +1,42 @@
+#pragma once
+
+// =============================================================================
+//  segmentClip.hpp - Liang-Barsky clipping of a segment against an AABB.
+//
+//  Used to trim toolpath segments to the region where the tool can touch the
+//  stock (the stock's box inflated by the tool's half extents) before they
+//  are carved: segments entirely outside (e.g. rapids at a safe height) are
+//  dropped, partially outside ones are shortened, which shrinks both the
+//  number of swept substeps and the dispatch footprint.
+//
+//  Header-only (same style as parallel.hpp).
+// =============================================================================
+
+#include <glm/glm.hpp>
+#include <utility>
+
+enum class ClipResult { INSIDE, CLIPPED, OUTSIDE };
+
+// Clip p0 -> p1 to [lo, hi] in place. OUTSIDE leaves the points untouched. If
+// `t` is set it receives the kept part as a parameter range of the original segment.
+inline ClipResult clipSegment(glm::vec3& p0, glm::vec3& p1, const glm::vec3& lo, const glm::vec3& hi, glm::vec2* t = nullptr) {
+  const glm::vec3 d = p1 - p0;
+  float t0 = 0.0f, t1 = 1.0f;
+  for (int a = 0; a < 3; ++a) {
+    if (d[a] == 0.0f) {
+      if (p0[a] < lo[a] || p0[a] > hi[a]) return ClipResult::OUTSIDE;  // parallel to the slab, outside it
+      continue;
+    }
+    float ta = (lo[a] - p0[a]) / d[a], tb = (hi[a] - p0[a]) / d[a];
+    if (ta > tb) std::swap(ta, tb);
+    if (ta > t0) t0 = ta;
+    if (tb < t1) t1 = tb;
+    if (t0 > t1) return ClipResult::OUTSIDE;
+  }
+  if (t) *t = glm::vec2(t0, t1);
+  if (t0 == 0.0f && t1 == 1.0f) return ClipResult::INSIDE;
+  const glm::vec3 start = p0;
+  p0 = start + t0 * d;
+  p1 = start + t1 * d;
+  return ClipResult::CLIPPED;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+// =============================================================================
+//  seqlock.hpp - Single-writer sequence lock for small snapshots.
+//
+//  The writer bumps the sequence to odd, stores the value, and bumps it back
+//  to even; a reader copies the value and retries if the sequence was odd or
+//  changed meanwhile. Neither side ever blocks the other, so a render thread
+//  can poll a position published by the carving thread at any rate.
+//
+//  The payload is stored as relaxed atomic words (no data race in the C++
+//  memory model); T must be trivially copyable.
+//
+//  Header-only (same style as parallel.hpp).
+// =============================================================================
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "Seqlock<T> needs a trivially copyable T");
+
+ public:
+  Seqlock() { store(T()); }
+
+  // Writer side (one thread only).
+  void store(const T& value) {
+    uint32_t buf[WORDS] = {};
+    std::memcpy(buf, &value, sizeof(T));
+    const uint32_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; ++i) words[i].store(buf[i], std::memory_order_relaxed);
+    seq.store(s + 2, std::memory_order_release);
+  }
+
+  // Reader side (any thread): a consistent copy of the last stored value.
+  T load() const {
+    uint32_t buf[WORDS];
+    uint32_t s0, s1;
+    do {
+      s0 = seq.load(std::memory_order_acquire);
+      for (size_t i = 0; i < WORDS; ++i) buf[i] = words[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      s1 = seq.load(std::memory_order_relaxed);
+    } while ((s0 & 1u) || s0 != s1);
+    T value;
+    std::memcpy(&value, buf, sizeof(T));
+    return value;
+  }
+
+ private:
+  static constexpr size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+  std::atomic<uint32_t> seq{0};
+  std::atomic<uint32_t> words[WORDS];
+};
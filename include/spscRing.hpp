@@ -0,0 +1,59 @@
+#pragma once
+
+// =============================================================================
+//  spscRing.hpp - Bounded lock-free single-producer/single-consumer ring.
+//
+//  One thread calls push(), one other thread calls pop(); neither ever takes a
+//  lock. The head and tail counters live on separate cache lines so the two
+//  sides do not false-share, and acquire/release ordering publishes the slot
+//  contents together with the counter.
+//
+//  Header-only (same style as parallel.hpp).
+// =============================================================================
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class SpscRing {
+ public:
+  // Capacity is rounded up to a power of two.
+  explicit SpscRing(size_t capacity) {
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+    slots.resize(cap);
+    mask = cap - 1;
+  }
+
+  size_t capacity() const { return mask + 1; }
+
+  // Producer side. Returns false (and leaves `value` untouched) if the ring is full.
+  bool push(T&& value) {
+    const size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) > mask) return false;
+    slots[t & mask] = std::move(value);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+  bool push(const T& value) {
+    T copy = value;
+    return push(std::move(copy));
+  }
+
+  // Consumer side. Returns false if the ring is empty.
+  bool pop(T& value) {
+    const size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) return false;
+    value = std::move(slots[h & mask]);
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  std::vector<T> slots;
+  size_t mask = 0;
+  alignas(64) std::atomic<size_t> head{0};  // next slot to pop (written by the consumer)
+  alignas(64) std::atomic<size_t> tail{0};  // next slot to push (written by the producer)
+};
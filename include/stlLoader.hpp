@@ -0,0 +1,39 @@
+#pragma once
+
+// =============================================================================
+//  stlLoader.hpp - Dependency-free binary/ASCII STL reader.
+//
+//  Voxelizing thousands of target parts was dominated by Assimp start-up and
+//  import (aiProcess_GenNormals included, normals we never use). This reader:
+//    - memory-maps the file (MappedFile);
+//    - parses binary STL straight into a triangle soup, in parallel;
+//    - parses ASCII STL in parallel, one line-aligned chunk per worker;
+//    - accepts multi-solid ASCII files (all solids are merged);
+//    - welds duplicate vertices with a hash grid into the indexed Mesh the
+//      voxelizer uploads (shared vertices, degenerate triangles dropped).
+//
+//  loadMesh() uses it for .stl files and keeps Assimp for the other formats.
+// =============================================================================
+
+#include <string>
+#include <vector>
+
+#include "meshTypes.hpp"
+
+// True if `path` ends in ".stl" (case-insensitive).
+bool isStlFile(const std::string& path);
+
+// Read a binary or ASCII STL as a triangle soup: 9 floats (3 vertices) per
+// triangle, in file order. Throws std::runtime_error on malformed input and on
+// a file without triangles (loadMesh() then falls back to Assimp).
+std::vector<float> readStlTriangles(const char* path);
+
+// Weld a triangle soup into an indexed mesh. A vertex within `cell` (or 1e-6 of
+// the bounding-box diagonal when cell <= 0) of an already welded one is merged
+// into it: the hash grid has `cell`-sized cells and the 27 cells around each
+// vertex are probed, so pairs straddling a cell boundary weld too. Triangles that
+// collapse after welding are dropped.
+Mesh weldTriangles(const std::vector<float>& soup, float cell = 0.0f);
+
+// readStlTriangles() + weldTriangles().
+Mesh loadStl(const char* path);
@@ -0,0 +1,94 @@
+#pragma once
+
+// =============================================================================
+//  toolpath.hpp - Compiled toolpath: the one form every consumer reads.
+//
+//  A G-code program is compiled once into a compact structure-of-arrays
+//  (end point, move type, feed, tool, source line per move). Carving, the
+//  G-code viewer and the jog cursor all read this form; nothing re-executes
+//  the program text.
+//
+//  Compiled toolpaths are cached on disk, keyed by the content hash of the
+//  program plus the compile options and the cache format version, so
+//  recompiling an unchanged program costs one hashing pass over the mapped file.
+//
+//  Cache file (<cacheDir>/<hash>.tp):
+//    "ACTP" | uint32 version | uint64 key | uint64 count | x | y | z |
+//    moveType | feed | tool | line
+// =============================================================================
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+enum class Plane { XY, ZX, YZ };
+
+// Motion mode (modal group 1).
+enum class MotionMode : uint8_t { NONE = 0, RAPID, LINEAR, ARC_CW, ARC_CCW };
+
+struct CompiledToolpath {
+  std::vector<float> x, y, z;     // end point of each move (machine coordinates, mm)
+  std::vector<uint8_t> moveType;  // MotionMode
+  std::vector<float> feed;        // F in effect (units/min)
+  std::vector<int32_t> tool;      // tool in the spindle (last M6)
+  std::vector<uint32_t> line;     // 1-based source line
+  uint64_t key = 0;               // cache key (content hash) it was compiled from
+
+  size_t size() const { return x.size(); }
+  bool empty() const { return x.empty(); }
+  glm::vec3 position(size_t i) const { return glm::vec3(x[i], y[i], z[i]); }
+  MotionMode motion(size_t i) const { return static_cast<MotionMode>(moveType[i]); }
+
+  void resize(size_t n) {
+    x.resize(n), y.resize(n), z.resize(n);
+    moveType.resize(n), feed.resize(n), tool.resize(n), line.resize(n);
+  }
+  void clear() { resize(0); }
+  void append(const CompiledToolpath& o) {
+    x.insert(x.end(), o.x.begin(), o.x.end()), y.insert(y.end(), o.y.begin(), o.y.end()), z.insert(z.end(), o.z.begin(), o.z.end());
+    moveType.insert(moveType.end(), o.moveType.begin(), o.moveType.end()), feed.insert(feed.end(), o.feed.begin(), o.feed.end());
+    tool.insert(tool.end(), o.tool.begin(), o.tool.end()), line.insert(line.end(), o.line.begin(), o.line.end());
+  }
+};
+
+// Options that change the compiled form (part of the cache key).
+struct ToolpathOptions {
+  double arcTolerance = 0.25;  // max chord error (sagitta) of tessellated G2/G3 arcs, mm
+  bool blockDelete = true;     // skip blocks starting with '/' (the control's block delete switch on)
+};
+
+// Per-axis affine map p' = p * scale + offset, applied once to a whole compiled
+// toolpath (e.g. millimetres -> workpiece voxel offsets) so the carving loop
+// never converts units per segment. Only positions are mapped; feeds stay mm/min.
+struct ToolpathTransform {
+  glm::vec3 scale = glm::vec3(1.0f);
+  glm::vec3 offset = glm::vec3(0.0f);
+
+  bool isIdentity() const { return scale == glm::vec3(1.0f) && offset == glm::vec3(0.0f); }
+  glm::vec3 apply(const glm::vec3& p) const { return p * scale + offset; }
+};
+
+// Map every position of `tp` in place (parallel).
+void transformToolpath(CompiledToolpath& tp, const ToolpathTransform& xf);
+
+// Drop toolpath points while keeping the path within `tolerance` of the original
+// (same units as the positions): a near-collinear merge, then Douglas-Peucker
+// on every run of moves that share move kind (rapid/cut), feed and tool. The
+// simplified and original polylines are within `tolerance` of each other both
+// ways (Hausdorff), so the carved volume moves by at most `tolerance`. The first
+// and last points are always kept. tolerance <= 0 copies the toolpath.
+void simplifyToolpath(const CompiledToolpath& in, CompiledToolpath& out, float tolerance);
+
+struct GcodeParseStats;
+
+// Compile the G-code program at `gcodePath`, reusing `<cacheDir>/<hash>.tp` when
+// present (pass an empty cacheDir to disable the cache). `fromCache` tells
+// whether the result was loaded from the cache.
+bool compileToolpath(const std::string& gcodePath, CompiledToolpath& out, const ToolpathOptions& opts, const std::string& cacheDir,
+                     GcodeParseStats* stats = nullptr, bool* fromCache = nullptr);
+
+// Cache file I/O (written through a temp file + atomic rename).
+bool saveCompiledToolpath(const CompiledToolpath& tp, const std::string& path);
+bool loadCompiledToolpath(const std::string& path, uint64_t expectedKey, CompiledToolpath& tp);
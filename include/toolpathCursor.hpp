@@ -0,0 +1,57 @@
+#pragma once
+
+// =============================================================================
+//  toolpathCursor.hpp - Arc-length cursor over a compiled toolpath.
+//
+//  Replaces the per-step jog API of GCodeInterpreter (one call, one mutex and
+//  one segment-length computation per step). The cumulative arc length of the
+//  toolpath is computed once; advance() then walks it and writes a whole batch
+//  of sample positions into caller-provided SoA arrays, with no locks and no
+//  allocation. Samples are `step` apart within every segment and every segment
+//  end is sampled as well, so corners are always stamped exactly.
+//
+//  The cursor publishes its position after every batch through a seqlock, so a
+//  viewer can read snapshot() at any time (from any thread) without blocking the
+//  stamping; simulate moves GcodeViewer's tool to it after every batch.
+// =============================================================================
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "seqlock.hpp"
+#include "toolpath.hpp"  // CompiledToolpath
+
+class ToolpathCursor {
+ public:
+  // `toolpath` is referenced, not copied: it must outlive the cursor.
+  explicit ToolpathCursor(const CompiledToolpath& toolpath);
+
+  // Position published after the last batch (readable from any thread).
+  struct Snapshot {
+    glm::vec3 position = glm::vec3(0.0f);
+    double distance = 0.0;  // arc length travelled
+    size_t segment = 0;     // segment in progress (entry segment -> segment + 1)
+  };
+  Snapshot snapshot() const { return published.load(); }
+
+  // Total arc length of the toolpath.
+  double length() const { return arcLength.empty() ? 0.0 : arcLength.back(); }
+
+  bool done() const { return segment + 1 >= path.size(); }
+  void reset();
+
+  // Advance by up to `capacity` samples, `step` apart, writing them to x/y/z.
+  // Returns the number of samples written; 0 once the toolpath is exhausted (or
+  // for a `step` <= 0, which would never move).
+  size_t advance(float step, float* x, float* y, float* z, size_t capacity);
+
+ private:
+  void publish(const glm::vec3& p);
+
+  const CompiledToolpath& path;
+  std::vector<double> arcLength;  // cumulative arc length at every entry
+  size_t segment = 0;             // current segment (entry segment -> segment + 1)
+  double along = 0.0;             // distance already covered within it
+  Seqlock<Snapshot> published;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+// =============================================================================
+//  toolpathStream.hpp - Streaming G-code -> carve pipeline.
+//
+//  A producer thread parses the mapped program window by window
+//  (parseGcodeStream) and hands each window's moves to the consumer through a
+//  lock-free SPSC ring (spscRing.hpp). The consumer (the carving loop) calls
+//  next() and processes each batch while the next windows are still being
+//  parsed, so parsing overlaps carving and the first segment is carved after
+//  one window instead of after the whole program.
+//
+//  Memory is constant: a fixed pool of batch buffers circulates between the
+//  two threads (a "full" ring towards the consumer, a "free" ring back to the
+//  producer); a batch is recycled when the consumer asks for the next one.
+//
+//  The producer also maps each batch to voxel space and simplifies it
+//  (simplifyToolpath), so the consumer only ever sees carve-ready moves.
+// =============================================================================
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gcodeParser.hpp"  // GcodeParseStats, parseGcodeStream
+#include "mappedFile.hpp"
+#include "spscRing.hpp"
+#include "toolpath.hpp"  // CompiledToolpath, ToolpathOptions, ToolpathTransform
+
+class ToolpathStream {
+ public:
+  // Maps `gcodePath` and starts the parser thread (throws std::runtime_error if
+  // the file cannot be opened). Batches are mapped through `xf` and then
+  // simplified within `simplifyTolerance` (0 = off) by the producer; simplifying
+  // keeps every batch's end points, so batches still join up. `batches` is the
+  // number of buffers in flight.
+  explicit ToolpathStream(const std::string& gcodePath, const ToolpathOptions& opts = ToolpathOptions(),
+                          const ToolpathTransform& xf = ToolpathTransform(), float simplifyTolerance = 0.0f, size_t batches = 4);
+  ~ToolpathStream();
+
+  ToolpathStream(const ToolpathStream&) = delete;
+  ToolpathStream& operator=(const ToolpathStream&) = delete;
+
+  // Next batch of moves in program order (blocks until one is ready), or nullptr
+  // once the program is exhausted. The batch stays valid until the next call.
+  const CompiledToolpath* next();
+
+  // Parse statistics; complete once next() has returned nullptr.
+  const GcodeParseStats& stats() const { return parseStats; }
+  // Time from construction to the first batch being available (ms).
+  double firstBatchMs() const { return firstMs; }
+  // Moves handed to the consumer after simplification; complete with stats().
+  size_t keptMoves() const { return kept; }
+
+ private:
+  void produce();
+
+  MappedFile file;
+  ToolpathOptions opts;
+  ToolpathTransform xf;
+  float simplifyTolerance;
+  CompiledToolpath simplified;  // producer scratch
+  std::vector<CompiledToolpath> pool;
+  SpscRing<uint32_t> fullSlots;  // producer -> consumer
+  SpscRing<uint32_t> freeSlots;  // consumer -> producer (recycled buffers)
+  int64_t current = -1;       // pool index held by the consumer
+  std::atomic<bool> done{false};
+  std::atomic<bool> cancel{false};
+  GcodeParseStats parseStats;  // written by the producer before `done`
+  size_t kept = 0;             // written by the producer before `done`
+  double firstMs = 0.0;        // written by the producer before the first push
+  std::chrono::high_resolution_clock::time_point t0;
+  std::thread producer;
+};
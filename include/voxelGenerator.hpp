@@ -0,0 +1,70 @@
+#pragma once
+
+// =============================================================================
+//  voxelGenerator.hpp - Voxel objects straight from analytic primitives.
+//
+//  Stocks and standard cutters do not need a mesh: a box, a cylinder or an
+//  end mill is described by a few numbers, and the solid part of every (x, y)
+//  column is one Z interval that can be computed exactly. The generator
+//  evaluates a list of primitives combined left to right with union and
+//  difference (simple CSG) on the interval lists of every column, rows split
+//  across all cores, and writes the transitions directly in the
+//  compressedData / prefixSumData layout of a .bin voxel object.
+//
+//  No OpenGL context, no mesh loading. The output follows the voxelizer
+//  conventions (voxelizerCPU.hpp): pixel centres, slice k at
+//  z = zSpan / 2 - k * zSpan / resZ, slice 0 always empty, a transition at k
+//  whenever slice k and slice k + 1 differ; columns are sorted.
+//
+//  Units are those of the model (mm). Boxes and cylinders stand on `origin`
+//  (the centre of their bottom face); cutters have their tip at `origin` and
+//  their axis along +Z, so the grid bottom is the tool tip as simulate expects.
+// =============================================================================
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+#include "boolOps.hpp"  // VoxelObject
+#include "parallel.hpp"
+
+enum class PrimitiveKind {
+  BOX,        // size.x * size.y * size.z
+  CYLINDER,   // diameter, length
+  FLAT_MILL,  // flat end mill: diameter, length
+  BALL_MILL,  // ball end mill: diameter, length
+  BULL_MILL,  // bull nose (corner radius) end mill: diameter, cornerRadius, length
+  V_BIT,      // V cutter: diameter, tipAngle (included, degrees), length
+};
+
+struct Primitive {
+  PrimitiveKind kind = PrimitiveKind::BOX;
+  glm::vec3 origin = glm::vec3(0.0f);  // bottom-face centre (box, cylinder) or tool tip
+  glm::vec3 size = glm::vec3(0.0f);    // BOX only
+  float diameter = 0.0f;
+  float length = 0.0f;  // along Z
+  float cornerRadius = 0.0f;
+  float tipAngle = 90.0f;
+  bool subtract = false;  // difference instead of union
+};
+
+struct GenerateStats {
+  size_t columns = 0;
+  size_t transitions = 0;
+  int maxTransitions = 0;  // per column
+  unsigned workers = 0;
+  double ms = 0.0;
+};
+
+// Parse one primitive: "[+|-]kind:a,b,...[@x,y,z]" with kind one of
+//   box:sx,sy,sz  cyl:d,l  flat:d,l  ball:d,l  bull:d,r,l  vbit:d,angle,l
+// '-' subtracts the primitive, '@' moves its origin (default 0,0,0).
+bool parsePrimitive(const std::string& spec, Primitive& out);
+
+// Voxelize `primitives` (applied in order to an empty solid) on a grid of
+// `resolution` units per voxel covering the union primitives, with slices
+// `resolution / zSub` apart (zSubdivision() of the result). Returns false
+// (with a message) when nothing is added or a primitive is degenerate.
+bool generateVoxelObject(const std::vector<Primitive>& primitives, float resolution, VoxelObject& out, int zSub = 1, GenerateStats* stats = nullptr,
+                         unsigned workers = workerCount());
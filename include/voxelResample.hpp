@@ -0,0 +1,54 @@
+#pragma once
+
+// =============================================================================
+//  voxelResample.hpp - Column resampling of voxel objects to another voxel size.
+//
+//  A tool voxelized at one --res can carve a stock of another resolution only
+//  after it has been brought to the stock's voxel size. Instead of
+//  re-voxelizing the mesh, the transitions of the existing object are
+//  resampled: every destination column reads the source columns it covers,
+//  merges their solid runs and maps them onto the destination slices. Rows of
+//  destination columns are split across all cores. Source and target voxels
+//  are square in XY with Z = XY / n, the only shapes the params can store.
+//
+//    NEAREST       a destination voxel takes the value of the source voxel
+//                  under its centre (volume preserving on average);
+//    CONSERVATIVE  a destination voxel is solid if any source voxel it
+//                  overlaps is solid (never loses material: for a tool, the
+//                  carved region only grows).
+//
+//  Source voxel sizes come from voxelSize() (Z subdivided objects included).
+//  The physical extent (center, scale, zSpan) is kept; resolutionXYZ becomes
+//  the new grid, `resolution` the new XY voxel size and the stored Z subdivision
+//  XY / Z, so the result reads back with voxelSize() == the target. Slice 0 stays
+//  on the top plane and stays empty (voxelizer conventions, voxelizerCPU.hpp).
+//
+//  loadResampledObject() is the cached entry point: results are stored in
+//  <cacheDir>/<hash>.bin, keyed by the content hash of the source .bin plus the
+//  target voxel size, the mode and the cache format version, so every tool is
+//  resampled once per resolution and later runs only hash and load it.
+// =============================================================================
+
+#include <glm/glm.hpp>
+#include <string>
+
+#include "boolOps.hpp"  // VoxelObject
+#include "parallel.hpp"
+
+enum class ResampleMode { NEAREST, CONSERVATIVE };
+
+// "nearest" | "conservative".
+bool parseResampleMode(const std::string& name, ResampleMode& mode);
+
+// Grid a resampling of an object with `params` to `voxelSize` produces.
+glm::ivec3 resampledResolution(const VoxelizationParams& params, const glm::vec3& voxelSize);
+
+// Resample `in` to `voxelSize` (model units per voxel; x == y, z == x / n) into `out`.
+void resampleVoxelObject(const VoxelObject& in, const glm::vec3& voxelSize, ResampleMode mode, VoxelObject& out, unsigned workers = workerCount());
+
+// Load the .bin at `path` at `voxelSize`: as is when it already has that voxel
+// size, else from the resampling cache, else resampled now and cached (pass an
+// empty cacheDir to disable the cache). `fromCache` tells whether the result
+// was loaded from the cache.
+bool loadResampledObject(const std::string& path, const glm::vec3& voxelSize, ResampleMode mode, const std::string& cacheDir, VoxelObject& out,
+                         bool* fromCache = nullptr);
@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 //#include <GLFW/glfw3.h>
+#include "boolOps.hpp"  // VoxelObject, SharedVoxelObject
 #include "shader.hpp"
 #include "voxelizer.hpp"
 
@@ -17,11 +18,9 @@ public:
     const std::string& prefixSumBufferFile,
     VoxelizationParams params);
 
-  // Constructor from memory buffers
-  VoxelViewer(
-    const std::vector<unsigned int>& compressedData,
-    const std::vector<unsigned int>& prefixSumData,
-    VoxelizationParams params);
+  // Constructor from a shared voxel object (no copy: the buffers are uploaded to
+  // the GPU straight from `obj`, and the viewer keeps no CPU-side reference)
+  explicit VoxelViewer(SharedVoxelObject obj);
 
   // Destructor
   ~VoxelViewer();
@@ -37,9 +36,6 @@ private:
   VoxelizationParams params;
   bool ortho = false; // Use perspective projection by default
 
-  std::vector<unsigned int> compressedData;
-  std::vector<unsigned int> prefixSumData;
-
   GLFWwindow* window = nullptr;
   GLuint quadVAO = 0;
   GLuint quadVBO = 0;
@@ -68,7 +64,7 @@ private:
 
   // Helpers
   void initGL();
-  void setupShaderAndBuffers();
+  void setupShaderAndBuffers(const std::vector<unsigned int>& compressedData, const std::vector<unsigned int>& prefixSumData);
   void renderFullScreenQuad();
   bool loadBinaryFile(const std::string& filename, std::vector<unsigned int>& outData);
 
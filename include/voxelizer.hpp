@@ -3,19 +3,34 @@
 #include <assimp/scene.h>
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <glm/glm.hpp>
+#include <stdexcept>
 #include <utility>
 #include <vector>
 
 #include "meshLoader.hpp"
 #include "meshTypes.hpp"
 
+// .bin format tag, written between the params and dataSize by every writer
+// (see VoxelFileTag). Files without it have dataSize there, which can never
+// equal the magic (an exabyte-sized section), so the two layouts can't be confused.
+#define VOXEL_FILE_MAGIC 0x564F5842494E3200ull  // "VOXBIN2\0"
+#define VOXEL_FILE_VERSION 2u
+
 // Parameters for voxelization
 struct VoxelizationParams {
   float resolution = 0.1;                                   // Resolution referred to the units of the model (agnostic with reference to which units are used)
   glm::ivec3 resolutionXYZ = glm::ivec3(1024, 1024, 1024);  // Resolution in pixels for each axis
 
   int slicesPerBlock = 32;
+  // Z subdivision, in the 4 bytes of padding before maxMemoryBudgetBytes so the
+  // struct (written raw in the .bin header) keeps its size and offsets. In memory
+  // only: readers take it from the VoxelFileTag, never from these bytes.
+  int zSub = 1;
   size_t maxMemoryBudgetBytes = 512 * 1024 * 1024;  // 512 MB
   int maxTransitionsPerZColumn = 32;
   glm::vec3 color = glm::vec3(1.0f, 1.0f, 1.0f);  // Default color (white)
@@ -25,6 +40,71 @@ struct VoxelizationParams {
 
   bool preview = false;  // Whether to render a preview during voxelization
 };
+static_assert(offsetof(VoxelizationParams, maxMemoryBudgetBytes) == 24, "zSub must fit the padding of the .bin header");
+
+// Written after the params of a .bin file: layout version and Z subdivision.
+// A file without it (older writers) is read as n = 1.
+struct VoxelFileTag {
+  uint64_t magic = VOXEL_FILE_MAGIC;
+  uint32_t version = VOXEL_FILE_VERSION;
+  uint32_t zSub = 1;
+};
+static_assert(sizeof(VoxelFileTag) == 16, "VoxelFileTag is written raw");
+
+// Size of a tagged .bin header: params | VoxelFileTag | dataSize | prefixSize.
+constexpr size_t voxelFileHeaderSize = sizeof(VoxelizationParams) + sizeof(VoxelFileTag) + 2 * sizeof(size_t);
+
+// Z subdivision of an object: its slices are `resolution / n` apart while its
+// columns are `resolution` wide, so every Z transition is a fixed-point value
+// with n steps per XY voxel (coarse XY, fine Z). Stored explicitly (a Z
+// extent over resolutionXYZ.z can't tell n apart for thin objects: a 0.5 thick
+// plate at resolution 1 is one slice for n = 1 and for n = 2); 1 for cubic
+// voxels and for .bin files without a VoxelFileTag.
+inline int zSubdivision(const VoxelizationParams& p) { return p.zSub >= 1 ? p.zSub : 1; }
+
+inline void storeZSubdivision(VoxelizationParams& p, int n) {
+  if (n < 1) throw std::out_of_range("Z subdivision must be at least 1");
+  p.zSub = n;
+}
+
+inline VoxelFileTag voxelFileTag(const VoxelizationParams& p) {
+  VoxelFileTag tag;
+  tag.zSub = (uint32_t)zSubdivision(p);
+  return tag;
+}
+
+// Voxel size per axis, in model units.
+inline glm::vec3 voxelSize(const VoxelizationParams& p) { return glm::vec3(p.resolution, p.resolution, p.resolution / zSubdivision(p)); }
+
+// Where the voxelization runs (not stored in the .bin: both produce the same layout).
+enum class VoxelizerBackend {
+  GPU,           // one rendered slice per Z layer (needs an OpenGL context)
+  GPU_TWO_PASS,  // same slices, count then fill: no per-column slot budget
+  CPU,           // one ray per column, all cores (voxelizerCPU.hpp)
+};
+
+struct GLFWwindow;
+class Shader;
+
+// OpenGL context and compiled voxelization programs. Each GPU voxelization makes
+// its own unless one is shared with setSharedGL() (voxelize-batch: one context
+// and one compilation for a whole library of meshes).
+class VoxelizerGL {
+ public:
+  VoxelizerGL(int width, int height, bool visible = false);  // throws std::runtime_error
+  ~VoxelizerGL();
+  VoxelizerGL(const VoxelizerGL&) = delete;
+  VoxelizerGL& operator=(const VoxelizerGL&) = delete;
+
+  GLFWwindow* window = nullptr;
+  Shader* draw = nullptr;         // vertex.glsl + fragment.glsl (slice rendering)
+  Shader* transitions = nullptr;  // transitions_xyz2.comp (fixed slots)
+  Shader* countFill = nullptr;    // transitions_count_fill.comp (two-pass)
+  Shader* compress = nullptr;     // compress_transitions.comp
+  Shader* prefixPass1 = nullptr;
+  Shader* prefixPass2 = nullptr;
+  Shader* prefixPass3 = nullptr;
+};
 
 class Voxelizer {
  public:
@@ -36,6 +116,17 @@ class Voxelizer {
   void setMesh(const Mesh& mesh);
   void setParams(const VoxelizationParams& params);
   VoxelizationParams getParams() const { return this->params; }
+  void setBackend(VoxelizerBackend b) { backend = b; }
+  VoxelizerBackend getBackend() const { return backend; }
+  // Largest XY tile a GPU pass may render (texture limit); grids that are larger,
+  // or whose buffers would not fit maxMemoryBudgetBytes, are voxelized in tiles.
+  void setMaxTileSize(int px) { maxTilePx = px; }
+  // Use `gl` (not owned, must outlive run()) instead of a context per run().
+  void setSharedGL(VoxelizerGL* gl) { sharedGL = gl; }
+  // Slice the mesh `n` times finer in Z than its XY voxel size (see zSubdivision()).
+  void setZSubdivision(int n);
+  // Threads of the CPU backend (0: all cores); the memory planner may use fewer.
+  void setWorkers(unsigned n) { workers = n; }
 
   void run();
   bool save(const std::string& filename);
@@ -51,6 +142,10 @@ class Voxelizer {
   std::vector<float> vertices;
   std::vector<unsigned int> indices;
   VoxelizationParams params;
+  VoxelizerBackend backend = VoxelizerBackend::GPU;
+  int maxTilePx = 4096;
+  VoxelizerGL* sharedGL = nullptr;
+  unsigned workers = 0;
   // float scale = 1.0f; // Scale factor for normalization
 
   std::vector<GLuint> compressedData;
@@ -61,8 +156,16 @@ class Voxelizer {
 
   std::pair<std::vector<GLuint>, std::vector<GLuint>> voxelizerZ_OLD(const std::vector<float>& vertices, const std::vector<unsigned int>& indices, float zSpan,
                                                                  const VoxelizationParams& params);
+  // `xyWindow` (left, right, bottom, top) is the part of the normalized XY square
+  // rendered on the params.resolutionXYZ.x/y grid: the whole square, or one tile.
   std::pair<std::vector<GLuint>, std::vector<GLuint>> voxelizerZ(const std::vector<float>& vertices, const std::vector<unsigned int>& indices, float zSpan,
-                                                                 const VoxelizationParams& params);
+                                                                 const VoxelizationParams& params,
+                                                                 const glm::vec4& xyWindow = glm::vec4(-0.5f, 0.5f, -0.5f, 0.5f));
+  std::pair<std::vector<GLuint>, std::vector<GLuint>> voxelizerZ_twoPass(const std::vector<float>& vertices, const std::vector<unsigned int>& indices,
+                                                                         float zSpan, const VoxelizationParams& params,
+                                                                         const glm::vec4& xyWindow = glm::vec4(-0.5f, 0.5f, -0.5f, 0.5f));
+  // GPU voxelization of the grid in tiles, stitched into one object.
+  void runTiled(float zSpan, glm::ivec2 tile);
 
   float computeZSpan() const;
   void clearResults();
@@ -0,0 +1,41 @@
+#pragma once
+
+// =============================================================================
+//  voxelizerCPU.hpp - GPU-less voxelizer: Z-transition columns straight from
+//  the mesh.
+//
+//  The GPU voxelizer renders the whole mesh once per Z slice and compares
+//  consecutive slices; this one casts a single ray per (x, y) column instead.
+//  Triangles are binned by pixel row, every row is rasterized independently
+//  (rows are split across all cores), and the sorted Z crossings of each
+//  column are turned into transitions written directly into the
+//  compressedData / prefixSumData layout of a .bin voxel object.
+//
+//  The output follows the GPU conventions exactly: same pixel centres (the
+//  normalized mesh spans [-0.5, 0.5] in X and Y), slice k at
+//  z = zSpan / 2 - k * zSpan / resZ (k grows downwards), slice 0 always empty,
+//  a slice is solid when the nearest surface below it faces down (for closed
+//  meshes this is ray parity), and a transition is stored at k whenever slice
+//  k and slice k + 1 differ. Columns are always sorted and never truncated.
+// =============================================================================
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "parallel.hpp"
+
+struct CpuVoxelizeStats {
+  size_t crossings = 0;    // ray/triangle hits
+  size_t transitions = 0;  // entries of compressedData
+  unsigned workers = 0;
+  double ms = 0.0;
+};
+
+// Voxelize the normalized mesh (`vertices` xyz triples, `indices` triangles) on
+// a res.x * res.y * res.z grid. `compressed` gets every column's transitions,
+// `prefix` the exclusive prefix sum of the column counts (res.x * res.y entries,
+// column index y * res.x + x).
+void voxelizeColumnsCPU(const std::vector<float>& vertices, const std::vector<unsigned int>& indices, float zSpan, const glm::ivec3& res,
+                        std::vector<uint32_t>& compressed, std::vector<uint32_t>& prefix, CpuVoxelizeStats* stats = nullptr,
+                        unsigned workers = workerCount());
@@ -1,13 +1,32 @@
 #pragma once
 
 #include <cstddef>
+#include <string>
 #include "voxelizer.hpp"
 
-// Estimate memory usage in bytes for the voxelization process
-size_t estimateMemoryUsageBytes(const VoxelizationParams& params);
+// "gpu" | "twopass" | "cpu" -> backend (CLI --backend). False if unknown.
+bool parseVoxelizerBackend(const std::string& name, VoxelizerBackend& backend);
+
+// Estimate GPU memory usage in bytes for the voxelization process (slices,
+// transition buffers and the compacted output: its worst case for "gpu", an
+// estimate for "twopass", whose output size is only known after counting)
+size_t estimateMemoryUsageBytes(const VoxelizationParams& params, VoxelizerBackend backend = VoxelizerBackend::GPU);
 
 // Choose the optimal number of slices per block under the memory budget
-int chooseOptimalSlicesPerBlock(const VoxelizationParams& params);
+int chooseOptimalSlicesPerBlock(const VoxelizationParams& params, VoxelizerBackend backend = VoxelizerBackend::GPU);
 
 // Choose the optimal power-of-two number of slices per block under the memory budget
-int chooseOptimalPowerOfTwoSlicesPerBlock(const VoxelizationParams& params);
+int chooseOptimalPowerOfTwoSlicesPerBlock(const VoxelizationParams& params, VoxelizerBackend backend = VoxelizerBackend::GPU);
+
+// XY tile size for a GPU voxelization: at most `maxTilePx` per side, halved
+// (largest side first) until one tile with a single slice per block fits
+// params.maxMemoryBudgetBytes. Equal to the grid when no tiling is needed.
+glm::ivec2 chooseTileSize(const VoxelizationParams& params, VoxelizerBackend backend, int maxTilePx);
+
+// Reorder `indices` (triangles) by ascending minimum Z and return the sorted
+// per-triangle zMin. A slice renders only what lies below its clipping plane, so
+// the triangles it can see are exactly the first trianglesBelow(zMin, z) ones.
+std::vector<float> sortTrianglesByZMin(const std::vector<float>& vertices, std::vector<unsigned int>& indices);
+
+// Number of triangles whose zMin <= z (a prefix of the sorted index buffer).
+size_t trianglesBelow(const std::vector<float>& zMinSorted, float z);
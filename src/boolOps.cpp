@@ -3,8 +3,15 @@
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <climits>
+#include <cstring>
 
+#include "hash.hpp"
+#include "parallel.hpp"
+#include "resultWriter.hpp"
 #include "voxelViewer.hpp"
 #include "voxelizer.hpp"
 
@@ -13,8 +20,11 @@
 #define WORKGROUPS 8
 #define WORKGROUPS_FLAT 8
 #define MAX_TRANSITIONS 32
+#define STENCIL_CACHE_BYTES (64u << 20)    // GPU memory budget of the swept-stencil cache
+#define STENCIL_MAX_SIGHTINGS (1u << 16)   // displacements remembered while waiting for a repeat
+#define MAX_SWEPT_INTERVALS 8              // intervals per swept column, non-convex tools (must match the shaders)
 
-BoolOps::BoolOps() {
+BoolOps::BoolOps() : stencils(STENCIL_CACHE_BYTES) {
   if (glfwGetCurrentContext() == nullptr) {
     throw std::runtime_error("No active OpenGL context found. Please create a context before using BoolOps.");
   }
@@ -30,11 +40,13 @@ BoolOps::BoolOps() {
   // shader2 = new Shader("shaders/subtract2.comp");          // Path to your compute shader file
   shader_flat = new Shader("shaders/subtract_flat.comp");            // per-step subtraction
   shader_swept = new Shader("shaders/subtract_swept.comp");          // swept-segment subtraction
+  shader_stencil = new Shader("shaders/subtract_stencil.comp");      // swept subtraction from a cached stencil
   compressShader = new Shader("shaders/compress_transitions.comp");  // GPU compaction for copyback
 }
 
 BoolOps::~BoolOps() {
   clear();
+  clearStencils();
 
   // Cleanup
   // if (obj1Compressed) glDeleteBuffers(1, &obj1Compressed);
@@ -45,8 +57,10 @@ BoolOps::~BoolOps() {
   if (outPrefix) glDeleteBuffers(1, &outPrefix);
   if (obj1_flat) glDeleteBuffers(1, &obj1_flat);
   if (obj1_dataNum) glDeleteBuffers(1, &obj1_dataNum);
-  if (obj2_compressed) glDeleteBuffers(1, &obj2_compressed);
-  if (obj2_prefix) glDeleteBuffers(1, &obj2_prefix);
+  for (const auto& t : tools) {
+    glDeleteBuffers(1, &t->compressed);
+    glDeleteBuffers(1, &t->prefix);
+  }
   if (atomicCounter) glDeleteBuffers(1, &atomicCounter);
 
   // if (shader) {
@@ -65,6 +79,10 @@ BoolOps::~BoolOps() {
     delete shader_swept;
     shader_swept = nullptr;
   }
+  if (shader_stencil) {
+    delete shader_stencil;
+    shader_stencil = nullptr;
+  }
   if (compressShader) {
     delete compressShader;
     compressShader = nullptr;
@@ -73,46 +91,80 @@ BoolOps::~BoolOps() {
   // destroyGLContext(glContext);
 }
 
-bool BoolOps::load(const std::string& filename) {
-  std::ifstream file(filename, std::ios::binary);
-  if (!file) {
-#ifdef DEBUG_OUTPUT
-    std::cerr << "Failed to open file for reading: " << filename << std::endl;
-#endif
-    return false;
+// .bin header: params | [VoxelFileTag] | dataSize | prefixSize. Sets the Z
+// subdivision from the tag (1 without it) and returns the header size, 0 on error.
+static size_t readHeader(std::istream& file, VoxelizationParams& params, size_t& dataSize, size_t& prefixSize) {
+  file.read(reinterpret_cast<char*>(&params), sizeof(VoxelizationParams));
+  VoxelFileTag tag;
+  file.read(reinterpret_cast<char*>(&tag.magic), sizeof(tag.magic));
+  size_t headerSize = sizeof(VoxelizationParams) + 2 * sizeof(size_t);
+  if (tag.magic == VOXEL_FILE_MAGIC) {
+    file.read(reinterpret_cast<char*>(&tag.version), sizeof(tag.version));
+    file.read(reinterpret_cast<char*>(&tag.zSub), sizeof(tag.zSub));
+    file.read(reinterpret_cast<char*>(&dataSize), sizeof(size_t));
+    headerSize += sizeof(VoxelFileTag);
+  } else {
+    static_assert(sizeof(tag.magic) == sizeof(size_t), "the tag magic takes the place of dataSize");
+    dataSize = (size_t)tag.magic;
+    tag.zSub = 1;
+  }
+  file.read(reinterpret_cast<char*>(&prefixSize), sizeof(size_t));
+  if (!file) return 0;
+  if (tag.version > VOXEL_FILE_VERSION || tag.zSub < 1 || tag.zSub > INT32_MAX) {
+    std::cerr << "Unsupported .bin format (version " << tag.version << ", Z subdivision " << tag.zSub << ")" << std::endl;
+    return 0;
   }
+  params.zSub = (int)tag.zSub;
+  return headerSize;
+}
 
+bool BoolOps::loadParams(const std::string& filename, VoxelizationParams& params, size_t* transitions) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file) return false;
+  size_t dataSize = 0, prefixSize = 0;
+  if (!readHeader(file, params, dataSize, prefixSize)) return false;
+  if (transitions) *transitions = dataSize / sizeof(GLuint);
+  return true;
+}
+
+bool BoolOps::load(const std::string& filename) {
   VoxelObject obj;
+  if (!loadObject(filename, obj)) return false;
 
-  // Read VoxelizationParams
-  file.read(reinterpret_cast<char*>(&obj.params), sizeof(VoxelizationParams));
+  this->objects.push_back(std::move(obj));
+
+  size_t objIndex = this->objects.size() - 1;
+  std::cout << "Object successfully loaded from file: " << filename << " at index " << objIndex << std::endl;
+
+  return true;
+}
+
+bool BoolOps::loadObject(const std::string& filename, VoxelObject& obj) {
+  std::ifstream file(filename, std::ios::binary);
   if (!file) {
 #ifdef DEBUG_OUTPUT
-    std::cerr << "Failed to read params from file: " << filename << std::endl;
+    std::cerr << "Failed to open file for reading: " << filename << std::endl;
 #endif
     return false;
   }
 
-  // Read the rest of the file into memory
-  file.seekg(0, std::ios::end);                           // Move to the end of the file
-  size_t fileSize = file.tellg();                         // Get the size of the file
-  file.seekg(sizeof(VoxelizationParams), std::ios::beg);  // Move back to the position after params
+  file.seekg(0, std::ios::end);    // Move to the end of the file
+  size_t fileSize = file.tellg();  // Get the size of the file
+  file.seekg(0, std::ios::beg);
 
+  // Read VoxelizationParams, the format tag and the data sizes
   size_t dataSize = 0;
   size_t prefixSize = 0;
-
-  file.read(reinterpret_cast<char*>(&dataSize), sizeof(size_t));
-  file.read(reinterpret_cast<char*>(&prefixSize), sizeof(size_t));
-
-  if (!file) {
+  const size_t headerSize = readHeader(file, obj.params, dataSize, prefixSize);
+  if (!headerSize) {
 #ifdef DEBUG_OUTPUT
-    std::cerr << "Failed to read data sizes from file: " << filename << std::endl;
+    std::cerr << "Failed to read header from file: " << filename << std::endl;
 #endif
     return false;
   }
 
   // Sanity check
-  if (fileSize != sizeof(VoxelizationParams) + 2 * sizeof(size_t) + dataSize + prefixSize) {
+  if (fileSize != headerSize + dataSize + prefixSize) {
 #ifdef DEBUG_OUTPUT
     std::cerr << "File size mismatch for " << filename << std::endl;
 #endif
@@ -143,11 +195,6 @@ bool BoolOps::load(const std::string& filename) {
   std::cout << "  prefixSize: " << prefixSize << std::endl;
 #endif
 
-  this->objects.push_back(std::move(obj));
-
-  size_t objIndex = this->objects.size() - 1;
-  std::cout << "Object successfully loaded from file: " << filename << " at index " << objIndex << std::endl;
-
   return true;
 }
 
@@ -157,45 +204,8 @@ bool BoolOps::save(const std::string& filename, int idx) {
     return false;
   }
 
-  const VoxelObject& obj = this->objects[idx];
-
-  if (obj.compressedData.empty() || obj.prefixSumData.empty()) {
-    std::cerr << "No data to save. Run voxelization first." << std::endl;
-    return false;
-  }
-
-  std::ofstream file(filename, std::ios::binary);
-  if (!file) {
-    std::cerr << "Failed to open file for writing: " << filename << std::endl;
-    return false;
-  }
-
-  // Save params first
-  file.write(reinterpret_cast<const char*>(&obj.params), sizeof(VoxelizationParams));
-  if (!file) {
-    std::cerr << "Failed to write params to file: " << filename << std::endl;
-    return false;
-  }
-
-  size_t dataSize = obj.compressedData.size() * sizeof(GLuint);
-  size_t prefixSize = obj.prefixSumData.size() * sizeof(GLuint);
-
-  std::cout << "Data size write (compressedData): " << dataSize << " bytes\n";
-  std::cout << "Prefix size write (prefixSumData): " << prefixSize << " bytes\n";
-
-  file.write(reinterpret_cast<const char*>(&dataSize), sizeof(size_t));
-  file.write(reinterpret_cast<const char*>(&prefixSize), sizeof(size_t));
-
-  file.write(reinterpret_cast<const char*>(obj.compressedData.data()), dataSize);
-  file.write(reinterpret_cast<const char*>(obj.prefixSumData.data()), prefixSize);
-
-  if (!file) {
-    throw std::runtime_error("Failed to write data to file: " + filename);
-  }
-
-  file.close();
-
-  return true;
+  // Same .bin layout as before, written through a temp file + atomic rename.
+  return writeVoxelObject(this->objects[idx], filename);
 }
 
 GLuint BoolOps::createBuffer(GLsizeiptr size, GLuint binding, GLenum usage) {
@@ -216,9 +226,11 @@ GLuint BoolOps::createBuffer(GLsizeiptr size, GLuint binding, GLenum usage, cons
   return buffer;
 }
 
-void BoolOps::loadBuffer(GLuint binding, const std::vector<GLuint>& data) {
+void BoolOps::loadBuffer(GLuint binding, const std::vector<GLuint>& data) { loadBuffer(binding, data.data(), data.size()); }
+
+void BoolOps::loadBuffer(GLuint binding, const GLuint* data, size_t count) {
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, binding);
-  glBufferData(GL_SHADER_STORAGE_BUFFER, data.size() * sizeof(GLuint), data.data(), GL_STATIC_READ);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(GLuint), data, GL_STATIC_READ);
   glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
 
@@ -774,51 +786,46 @@ bool BoolOps::subtractGPU_sequence(const VoxelObject& obj1, const VoxelObject& o
 }
 */
 
-bool BoolOps::unpackObject(const VoxelObject& obj, uint maxTransitions, std::vector<GLuint>& unpackedData, std::vector<GLuint>& validDataNum) {
-  // Clear output vectors
-  unpackedData.clear();
-  validDataNum.clear();
-
+bool BoolOps::unpackObject(const VoxelObject& obj, uint maxTransitions, HugePageBuffer<GLuint>& unpackedData, std::vector<GLuint>& validDataNum) {
   // Number of (x, y) columns
-  size_t numColumns = obj.prefixSumData.size();
-
-  // Reserve space for efficiency
-  unpackedData.reserve(numColumns * maxTransitions);
-  validDataNum.reserve(numColumns);
-
-  for (size_t col = 0; col < numColumns; ++col) {
-    size_t start = obj.prefixSumData[col];
-    size_t end = (col + 1 < numColumns) ? obj.prefixSumData[col + 1] : obj.compressedData.size();
-    size_t count = end - start;
-
-    if (count > maxTransitions) {
-      // Too many transitions for this column
-      return false;
-    }
-
-    // Copy transitions for this column
-    for (size_t i = 0; i < count; ++i) {
-      unpackedData.push_back(obj.compressedData[start + i]);
-    }
-
-    // Pad with zeros if needed
-    for (size_t i = count; i < maxTransitions; ++i) {
-      unpackedData.push_back(0);
-    }
-
-    validDataNum.push_back(count);  // Store the number of valid transitions for this column
-  }
+  const size_t numColumns = obj.prefixSumData.size();
+
+  // Mapped, not zeroed: every worker writes (first-touches) its own contiguous
+  // range of columns, transitions then zero padding, so its pages land on its NUMA node.
+  unpackedData.allocate(numColumns * maxTransitions);
+  validDataNum.resize(numColumns);
+
+  std::atomic<bool> ok{true};
+  parallelFor(
+      numColumns,
+      [&](size_t b, size_t e, unsigned) {
+        for (size_t col = b; col < e; ++col) {
+          const size_t start = obj.prefixSumData[col];
+          const size_t end = (col + 1 < numColumns) ? obj.prefixSumData[col + 1] : obj.compressedData.size();
+          const size_t count = end - start;
+          if (count > maxTransitions) {
+            ok = false;  // too many transitions for this column
+            return;
+          }
+          GLuint* dst = unpackedData.data() + col * maxTransitions;
+          if (count) std::memcpy(dst, obj.compressedData.data() + start, count * sizeof(GLuint));
+          std::fill(dst + count, dst + maxTransitions, 0u);
+          validDataNum[col] = (GLuint)count;  // number of valid transitions for this column
+        }
+      },
+      workerCount(), 4096);
 
-  return true;
+  return ok;
 }
 
-bool BoolOps::subtractGPU_init(const VoxelObject& obj1, const VoxelObject& obj2) {
+bool BoolOps::subtractGPU_init(const VoxelObject& obj1) {
   // Unpack obj1 to a flat array for GPU processing
   if (!unpackObject(obj1, MAX_TRANSITIONS, unpacked, dataNum)) {
     std::cerr << "Failed to unpack obj1 for GPU flat subtraction." << std::endl;
     return false;
   } else {
-    std::cout << "Unpacked obj1 size: " << (unpacked.size() * sizeof(GLuint)) / (1024.0 * 1024.0) << " MB" << std::endl;
+    std::cout << "Unpacked obj1 size: " << (unpacked.size() * sizeof(GLuint)) / (1024.0 * 1024.0) << " MB"
+              << (unpacked.onExplicitHugePages() ? " (explicit huge pages)" : "") << std::endl;
   }
 
   shader_flat->use();
@@ -826,41 +833,29 @@ bool BoolOps::subtractGPU_init(const VoxelObject& obj1, const VoxelObject& obj2)
   // Delete old buffers if they exist
   deleteBuffer(obj1_flat);
   deleteBuffer(obj1_dataNum);
-  deleteBuffer(obj2_compressed);
-  deleteBuffer(obj2_prefix);
 
   // Create buffers
   // IN/OUT
   obj1_flat = createBuffer(unpacked.size() * sizeof(GLuint), 0, GL_DYNAMIC_COPY);
   obj1_dataNum = createBuffer(dataNum.size() * sizeof(GLuint), 1, GL_DYNAMIC_COPY);
-  obj2_compressed = createBuffer(obj2.compressedData.size() * sizeof(GLuint), 2, GL_STATIC_READ);
-  obj2_prefix = createBuffer(obj2.prefixSumData.size() * sizeof(GLuint), 3, GL_STATIC_READ);
 
 #ifdef DEBUG_OUTPUT
   debugCounter = createAtomicCounter(4);
   zeroAtomicCounter(debugCounter);  // Initialize atomic counter to zero
 #endif
 
-  loadBuffer(obj1_flat, unpacked);                   // Load data into the buffer
+  loadBuffer(obj1_flat, unpacked.data(), unpacked.size());  // Load data into the buffer
   loadBuffer(obj1_dataNum, dataNum);                 // Load valid data count into the buffer
-  loadBuffer(obj2_compressed, obj2.compressedData);  // Load data into the buffer
-  loadBuffer(obj2_prefix, obj2.prefixSumData);       // Load prefix sum
 
   // Define parameters
   long w1 = obj1.params.resolutionXYZ.x;
   long h1 = obj1.params.resolutionXYZ.y;
   long z1 = obj1.params.resolutionXYZ.z;
-  long w2 = obj2.params.resolutionXYZ.x;
-  long h2 = obj2.params.resolutionXYZ.y;
-  long z2 = obj2.params.resolutionXYZ.z;
 
-  // Set uniforms
+  // Set uniforms (the tool's w2/h2/z2 are set by selectTool)
   shader_flat->setInt("w1", w1);
   shader_flat->setInt("h1", h1);
   shader_flat->setInt("z1", z1);
-  shader_flat->setInt("w2", w2);
-  shader_flat->setInt("h2", h2);
-  shader_flat->setInt("z2", z2);
   shader_flat->setUInt("maxTransitions", MAX_TRANSITIONS);
 
   // Setup dispatch parameters
@@ -870,13 +865,76 @@ bool BoolOps::subtractGPU_init(const VoxelObject& obj1, const VoxelObject& obj2)
   return true;
 }
 
-bool BoolOps::subtractSwept(glm::ivec3 startOffset, glm::ivec3 displacement) {
-  if (objects.size() != 2) {
-    std::cerr << "BoolOps::subtractSwept: Expected exactly 2 objects, got " << objects.size() << std::endl;
+bool BoolOps::addTool(VoxelObject&& tool, int number) {
+  if (toolIndex.count(number)) {
+    std::cerr << "BoolOps::addTool: tool T" << number << " already in the library" << std::endl;
+    return false;
+  }
+  auto slot = std::make_unique<ToolSlot>();
+  slot->number = number;
+  slot->id = nextToolId++;
+  slot->obj = std::move(tool);
+  // Uploaded once; createBuffer binds at 2/3, so restore the active tool's bindings after.
+  slot->compressed = createBuffer(slot->obj.compressedData.size() * sizeof(GLuint), 2, GL_STATIC_READ);
+  slot->prefix = createBuffer(slot->obj.prefixSumData.size() * sizeof(GLuint), 3, GL_STATIC_READ);
+  loadBuffer(slot->compressed, slot->obj.compressedData);
+  loadBuffer(slot->prefix, slot->obj.prefixSumData);
+  prepareSweptTool(*slot);
+
+  ToolSlot* added = slot.get();
+  tools.push_back(std::move(slot));
+  toolIndex[number] = added;
+  ToolSlot* current = active;
+  active = nullptr;
+  return selectTool(current ? current->number : number);
+}
+
+bool BoolOps::selectTool(int number) {
+  auto it = toolIndex.find(number);
+  bool found = it != toolIndex.end();
+  if (!found) it = toolIndex.find(DEFAULT_TOOL);
+  ToolSlot* slot = it != toolIndex.end() ? it->second : nullptr;
+  if (!slot || slot == active) return found;
+
+  active = slot;
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, slot->compressed);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, slot->prefix);
+  // Per-step stamping reads the tool size from uniforms; the swept kernels set theirs per dispatch.
+  shader_flat->use();
+  shader_flat->setInt("w2", slot->obj.params.resolutionXYZ.x);
+  shader_flat->setInt("h2", slot->obj.params.resolutionXYZ.y);
+  shader_flat->setInt("z2", slot->obj.params.resolutionXYZ.z);
+  return found;
+}
+
+void BoolOps::subtractGPU_reset() {
+  // `unpacked` / `dataNum` still hold obj1 as uploaded by subtractGPU_init(): carving
+  // only touches the GPU copies, so re-uploading them in place restores the workpiece
+  // without unpacking it again or reallocating the buffers.
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, obj1_flat);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, unpacked.size() * sizeof(GLuint), unpacked.data());
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, obj1_dataNum);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, dataNum.size() * sizeof(GLuint), dataNum.data());
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+// CPU twin of substepOffset() in subtract_swept.comp: round(k * d / K), ties away
+// from zero, in integers so both sides place every substep on the same voxel.
+static int substepOffset(int k, int d, int K) {
+  if (K <= 0) return 0;
+  const int q = (2 * k * std::abs(d) + K) / (2 * K);
+  return d < 0 ? -q : q;
+}
+
+bool BoolOps::subtractSwept(glm::ivec3 startOffset, glm::ivec3 displacement, int firstSubstep, int lastSubstep) {
+  if (objects.empty() || !active) {
+    std::cerr << "BoolOps::subtractSwept: workpiece or tool missing" << std::endl;
     return false;
   }
-  const VoxelObject& obj1 = objects[0];  // workpiece
-  const VoxelObject& obj2 = objects[1];  // tool
+  const VoxelObject& obj1 = objects[0];    // workpiece
+  const VoxelObject& obj2 = active->obj;  // active tool
+  const int sweptSlots = active->sweptSlots;
 
   long w1 = obj1.params.resolutionXYZ.x, h1 = obj1.params.resolutionXYZ.y, z1 = obj1.params.resolutionXYZ.z;
   long w2 = obj2.params.resolutionXYZ.x, h2 = obj2.params.resolutionXYZ.y, z2 = obj2.params.resolutionXYZ.z;
@@ -891,15 +949,67 @@ bool BoolOps::subtractSwept(glm::ivec3 startOffset, glm::ivec3 displacement) {
   // Sub-positions sampled at ~1-voxel spacing along the dominant axis.
   glm::ivec3 ad = glm::abs(tDelta);
   int K = glm::max(glm::max(ad.x, ad.y), ad.z);
-
-  // Swept bounding box in workpiece space (tool footprint over the whole segment).
-  long minTx = glm::min(tStart.x, tEnd.x), maxTx = glm::max(tStart.x, tEnd.x);
-  long minTy = glm::min(tStart.y, tEnd.y), maxTy = glm::max(tStart.y, tEnd.y);
+  firstSubstep = glm::max(firstSubstep, 0);
+  lastSubstep = glm::min(lastSubstep, K);
+  if (firstSubstep > lastSubstep) return true;
+  const bool wholeSegment = firstSubstep == 0 && lastSubstep == K;
+
+  // Swept bounding box in workpiece space (tool footprint over the carved substeps;
+  // substep offsets are monotonic, so the first and last ones bound it).
+  const glm::ivec3 tFirst = tStart + glm::ivec3(substepOffset(firstSubstep, tDelta.x, K), substepOffset(firstSubstep, tDelta.y, K), 0);
+  const glm::ivec3 tLast = tStart + glm::ivec3(substepOffset(lastSubstep, tDelta.x, K), substepOffset(lastSubstep, tDelta.y, K), 0);
+  long minTx = glm::min(tFirst.x, tLast.x), maxTx = glm::max(tFirst.x, tLast.x);
+  long minTy = glm::min(tFirst.y, tLast.y), maxTy = glm::max(tFirst.y, tLast.y);
+  // The tool covers columns [t - w2/2, t - w2/2 + w2) (all w2 of them, odd widths included).
   long baseX = glm::clamp(minTx - w2 / 2, 0L, w1);
-  long endX = glm::clamp(maxTx + w2 / 2, 0L, w1);
+  long endX = glm::clamp(maxTx - w2 / 2 + w2, 0L, w1);
   long baseY = glm::clamp(minTy - h2 / 2, 0L, h1);
-  long endY = glm::clamp(maxTy + h2 / 2, 0L, h1);
+  long endY = glm::clamp(maxTy - h2 / 2 + h2, 0L, h1);
   if (endX <= baseX || endY <= baseY) return true;  // swept tool entirely outside the workpiece
+  GLuint gX = (GLuint)((endX - baseX + WORKGROUPS_FLAT - 1) / WORKGROUPS_FLAT);
+  GLuint gY = (GLuint)((endY - baseY + WORKGROUPS_FLAT - 1) / WORKGROUPS_FLAT);
+
+  // Cached stencil: the envelope is only placed and merged. A displacement is
+  // cached on its second use, so one-off segments never pay for a stencil build.
+  // Stencils hold whole segments: a substep sub-range always runs the kernel.
+  const StencilKey key{active->id, tDelta};
+  const Stencil* stencil = wholeSegment ? stencils.find(key) : nullptr;
+  if (wholeSegment && !stencil && stencilSightings.count(key)) {
+    Stencil built;
+    if (buildStencil(tDelta, built)) {
+      stencilSightings.erase(key);
+      ++stencilStats.built;
+      stencils.insert(key, built, (size_t)built.width * built.height * sweptSlots * 2 * sizeof(GLint), [this](Stencil& s) {
+        glDeleteBuffers(1, &s.buffer);
+        ++stencilStats.evicted;
+      });
+      stencil = stencils.find(key);  // null if it was larger than the whole budget
+    }
+  }
+  if (stencil) {
+    ++stencilStats.hits;
+    shader_stencil->use();
+    shader_stencil->setInt("w1", w1);
+    shader_stencil->setInt("h1", h1);
+    shader_stencil->setInt("z1", z1);
+    shader_stencil->setUInt("maxTransitions", MAX_TRANSITIONS);
+    shader_stencil->setInt("baseX", (int)baseX);
+    shader_stencil->setInt("baseY", (int)baseY);
+    shader_stencil->setIVec2("stencilOrigin", glm::ivec2(minTx - w2 / 2, minTy - h2 / 2));
+    shader_stencil->setInt("stencilW", stencil->width);
+    shader_stencil->setInt("stencilH", stencil->height);
+    shader_stencil->setInt("zStart", tStart.z);
+    shader_stencil->setInt("sweptSlots", sweptSlots);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, stencil->buffer);
+    glDispatchCompute(gX, gY, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    return true;
+  }
+  ++stencilStats.misses;
+  if (wholeSegment) {
+    if (stencilSightings.size() >= STENCIL_MAX_SIGHTINGS) stencilSightings.clear();
+    stencilSightings.insert(key);
+  }
 
   shader_swept->use();
   shader_swept->setInt("w1", w1);
@@ -914,30 +1024,175 @@ bool BoolOps::subtractSwept(glm::ivec3 startOffset, glm::ivec3 displacement) {
   shader_swept->setIVec3("translateStart", tStart);
   shader_swept->setIVec3("translateDelta", tDelta);
   shader_swept->setInt("numSubsteps", K);
+  shader_swept->setInt("substepFirst", firstSubstep);
+  shader_swept->setInt("substepLast", lastSubstep);
+  shader_swept->setInt("sweptSlots", sweptSlots);
 
-  GLuint gX = (GLuint)((endX - baseX + WORKGROUPS_FLAT - 1) / WORKGROUPS_FLAT);
-  GLuint gY = (GLuint)((endY - baseY + WORKGROUPS_FLAT - 1) / WORKGROUPS_FLAT);
   glDispatchCompute(gX, gY, 1);
   glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
   return true;
 }
 
+size_t BoolOps::StencilKeyHash::operator()(const StencilKey& k) const {
+  const int32_t v[4] = {(int32_t)k.tool, k.delta.x, k.delta.y, k.delta.z};
+  return (size_t)fnv1a64(v, sizeof(v));
+}
+
+void BoolOps::setStencilCacheBytes(size_t bytes) {
+  stencils.setCapacity(bytes, [this](Stencil& s) {
+    glDeleteBuffers(1, &s.buffer);
+    ++stencilStats.evicted;
+  });
+}
+
+size_t BoolOps::defaultStencilCacheBytes() { return STENCIL_CACHE_BYTES; }
+
+size_t BoolOps::flatTransitionsPerColumn() { return MAX_TRANSITIONS; }
+
+void BoolOps::clearStencils() {
+  stencils.clear([](Stencil& s) { glDeleteBuffers(1, &s.buffer); });
+  stencilSightings.clear();
+}
+
+// CPU twin of addInterval() in subtract_swept.comp: union [a, b) into the sorted,
+// disjoint half-open intervals iv[0..n) (lo, hi pairs; room for slots + 1), then
+// close the smallest gap while there are more than `slots`.
+static void addSweptInterval(GLint* iv, int& n, int slots, GLint a, GLint b) {
+  int i = 0;
+  while (i < n && iv[2 * i + 1] < a) ++i;
+  if (i == n || iv[2 * i] > b) {
+    std::copy_backward(iv + 2 * i, iv + 2 * n, iv + 2 * n + 2);
+    iv[2 * i] = a;
+    iv[2 * i + 1] = b;
+    ++n;
+  } else {
+    iv[2 * i] = std::min(iv[2 * i], a);
+    iv[2 * i + 1] = std::max(iv[2 * i + 1], b);
+    while (i + 1 < n && iv[2 * i + 2] <= iv[2 * i + 1]) {
+      iv[2 * i + 1] = std::max(iv[2 * i + 1], iv[2 * i + 3]);
+      std::copy(iv + 2 * i + 4, iv + 2 * n, iv + 2 * i + 2);
+      --n;
+    }
+  }
+  if (n > slots) {
+    int g = 0;
+    for (int j = 1; j + 1 < n; ++j)
+      if (iv[2 * j + 2] - iv[2 * j + 1] < iv[2 * g + 2] - iv[2 * g + 1]) g = j;
+    iv[2 * g + 1] = iv[2 * g + 3];
+    std::copy(iv + 2 * g + 4, iv + 2 * n, iv + 2 * g + 2);
+    --n;
+  }
+}
+
+void BoolOps::prepareSweptTool(ToolSlot& slot) {
+  const VoxelObject& tool = slot.obj;
+  // Every tool column as intervals: its solid intervals when the swept kernel keeps
+  // several per column, or just [lowest, highest] transition (convex tools).
+  const size_t columns = (size_t)tool.params.resolutionXYZ.x * tool.params.resolutionXYZ.y;
+  const std::vector<GLuint>& data = tool.compressedData;
+  const std::vector<GLuint>& prefix = tool.prefixSumData;
+  size_t maxIntervals = 0;
+  for (size_t i = 0; i < columns && i < prefix.size(); ++i) {
+    const size_t s = prefix[i], e = (i + 1 < prefix.size()) ? prefix[i + 1] : data.size();
+    if (e > s) maxIntervals = std::max(maxIntervals, (e - s) / 2);
+  }
+  // Unions of shifted copies can hold more intervals than the tool itself: allow twice as many.
+  slot.sweptSlots = maxIntervals <= 1 ? 1 : (int)std::min<size_t>(MAX_SWEPT_INTERVALS, 2 * maxIntervals);
+
+  std::vector<GLint>& toolIntervals = slot.intervals;
+  toolIntervals.clear();
+  slot.intervalStart.assign(columns + 1, 0);
+  for (size_t i = 0; i < columns; ++i) {
+    slot.intervalStart[i] = (uint32_t)toolIntervals.size();
+    if (i >= prefix.size()) continue;
+    const size_t s = prefix[i], e = (i + 1 < prefix.size()) ? prefix[i + 1] : data.size();
+    if (e <= s) continue;  // empty tool column
+    if (slot.sweptSlots == 1) {
+      toolIntervals.push_back((GLint)data[s]);
+      toolIntervals.push_back((GLint)data[e - 1]);
+    } else {
+      for (size_t t = s; t + 1 < e; t += 2) {
+        toolIntervals.push_back((GLint)data[t]);
+        toolIntervals.push_back((GLint)data[t + 1]);
+      }
+    }
+  }
+  slot.intervalStart[columns] = (uint32_t)toolIntervals.size();
+}
+
+bool BoolOps::buildStencil(glm::ivec3 tDelta, Stencil& out) {
+  // Same envelope as subtract_swept.comp, evaluated once on the CPU: for every
+  // substep k the tool (shifted by substepOffset(k, delta, K)) adds its column intervals
+  // to the stencil columns it covers. Stencil column (0,0) is the swept box
+  // origin, i.e. the tool's first column at min(0, delta); Z is relative to the
+  // start. Each column holds sweptSlots (lo, hi) pairs, unused ones lo > hi.
+  const VoxelObject& tool = active->obj;
+  const std::vector<GLint>& toolIntervals = active->intervals;
+  const std::vector<uint32_t>& toolIntervalStart = active->intervalStart;
+  const int w2 = tool.params.resolutionXYZ.x, h2 = tool.params.resolutionXYZ.y, z2 = tool.params.resolutionXYZ.z;
+  const int W = w2 + std::abs(tDelta.x), H = h2 + std::abs(tDelta.y);
+  const glm::ivec3 ad = glm::abs(tDelta);
+  const int K = std::max(std::max(ad.x, ad.y), ad.z);
+  const int slots = active->sweptSlots;
+
+  std::vector<glm::ivec3> shift(K + 1);  // per substep: (x, y) stencil shift and Z shift
+  for (int k = 0; k <= K; ++k) {
+    const glm::ivec3 r(substepOffset(k, tDelta.x, K), substepOffset(k, tDelta.y, K), substepOffset(k, tDelta.z, K));
+    shift[k] = glm::ivec3(r.x - std::min(0, tDelta.x), r.y - std::min(0, tDelta.y), r.z - z2 / 2);
+  }
+
+  // Every row is written by the worker that owns it. The envelope lives in a
+  // member scratch buffer: a miss only allocates when it is larger than any before.
+  stencilEnv.resize((size_t)W * H * slots * 2);
+  GLint* env = stencilEnv.data();
+  parallelFor(H, [&](size_t y0, size_t y1, unsigned) {
+    std::vector<GLint> work((size_t)W * (slots + 1) * 2);  // one row, one spare slot per column
+    std::vector<int> count(W);
+    for (size_t sy = y0; sy < y1; ++sy) {
+      std::fill(count.begin(), count.end(), 0);
+      for (const glm::ivec3& sh : shift) {
+        const int y2 = (int)sy - sh.y;
+        if (y2 < 0 || y2 >= h2) continue;
+        for (int x2 = 0; x2 < w2; ++x2) {
+          const size_t c = (size_t)x2 + (size_t)y2 * w2;
+          const int sx = x2 + sh.x;
+          for (uint32_t t = toolIntervalStart[c]; t < toolIntervalStart[c + 1]; t += 2)
+            addSweptInterval(&work[(size_t)sx * (slots + 1) * 2], count[sx], slots, toolIntervals[t] + sh.z, toolIntervals[t + 1] + sh.z);
+        }
+      }
+      GLint* row = &env[sy * W * slots * 2];
+      for (int sx = 0; sx < W; ++sx) {
+        const GLint* iv = &work[(size_t)sx * (slots + 1) * 2];
+        for (int i = 0; i < slots; ++i) {
+          row[2 * (sx * slots + i)] = i < count[sx] ? iv[2 * i] : INT_MAX;
+          row[2 * (sx * slots + i) + 1] = i < count[sx] ? iv[2 * i + 1] : INT_MIN;
+        }
+      }
+    }
+  }, workerCount(), 8);
+
+  glGenBuffers(1, &out.buffer);
+  if (!out.buffer) return false;
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, out.buffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, stencilEnv.size() * sizeof(GLint), env, GL_STATIC_DRAW);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  out.width = W;
+  out.height = H;
+  return true;
+}
+
 void BoolOps::subtractGPU_copyback(VoxelObject& out) {
   // Make all carving writes to obj1_flat / obj1_dataNum complete and visible.
   glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
   glFinish();
 
   // 1. Read back only the per-column transition counts (small: w*h uints).
-  dataNum = readBuffer(obj1_dataNum, dataNum.size());
+  //    Kept apart from `dataNum`, which holds the pristine counts for subtractGPU_reset().
+  std::vector<GLuint> prefixSumData = readBuffer(obj1_dataNum, dataNum.size());
 
-  // 2. CPU exclusive prefix sum of the counts -> per-column offsets (= prefixSumData) + total.
-  const size_t n = dataNum.size();
-  std::vector<GLuint> prefixSumData(n);
-  GLuint total = 0;
-  for (size_t i = 0; i < n; ++i) {
-    prefixSumData[i] = total;
-    total += dataNum[i];
-  }
+  // 2. CPU exclusive prefix sum of the counts, in place and on all cores -> per-column offsets + total.
+  const size_t n = prefixSumData.size();
+  const GLuint total = (GLuint)parallelExclusiveScan(prefixSumData.data(), n);
 
   // 3. Compact the unpacked flat buffer on the GPU, so we read back ~`total`
   //    transitions instead of the whole 32-slots-per-column buffer (e.g. 128 MB).
@@ -961,16 +1216,20 @@ void BoolOps::subtractGPU_copyback(VoxelObject& out) {
   // 5. Free temporaries and restore the carving bindings (so a later carve still works).
   glDeleteBuffers(1, &prefixBuf);
   glDeleteBuffers(1, &compBuf);
-  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, obj2_compressed);
-  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, obj2_prefix);
+  if (active) {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, active->compressed);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, active->prefix);
+  }
 
   out.compressedData = std::move(compressedData);
   out.prefixSumData = std::move(prefixSumData);
 }
 
-bool BoolOps::subtractGPU(glm::ivec3 offset) {
-  if (objects.size() != 2) {
-    std::cerr << "BoolOps::subtractGPU: Expected exactly 2 objects, got " << objects.size() << std::endl;
+bool BoolOps::subtractGPU(glm::ivec3 offset) { return subtractGPU(&offset, 1); }
+
+bool BoolOps::subtractGPU(const glm::ivec3* offsets, size_t count) {
+  if (objects.empty() || !active) {
+    std::cerr << "BoolOps::subtractGPU: workpiece or tool missing" << std::endl;
     return false;
   }
   const VoxelObject& obj1 = objects[0];  // reference: avoid copying the whole workpiece each step
@@ -984,34 +1243,42 @@ bool BoolOps::subtractGPU(glm::ivec3 offset) {
   long w1 = obj1.params.resolutionXYZ.x;
   long h1 = obj1.params.resolutionXYZ.y;
   long z1 = obj1.params.resolutionXYZ.z;
-
-  glm::vec3 translate(w1 / 2 + offset.x, h1 / 2 + offset.y, z1 / 2 - offset.z);
-  shader_flat->setIVec3("translate", translate);
-
-  // Restrict the dispatch to the tool's bounding box in workpiece space: threads
-  // outside the tool AOI would only early-return, so don't even launch them.
-  long w2 = objects[1].params.resolutionXYZ.x;
-  long h2 = objects[1].params.resolutionXYZ.y;
-  long baseX = glm::clamp((long)translate.x - w2 / 2, 0L, w1);
-  long baseY = glm::clamp((long)translate.y - h2 / 2, 0L, h1);
-  long endX = glm::clamp((long)translate.x + w2 / 2, 0L, w1);
-  long endY = glm::clamp((long)translate.y + h2 / 2, 0L, h1);
-  if (endX <= baseX || endY <= baseY) return true;  // tool fully outside the workpiece
-  shader_flat->setInt("baseX", (int)baseX);
-  shader_flat->setInt("baseY", (int)baseY);
-  GLuint gX = (GLuint)((endX - baseX + WORKGROUPS_FLAT - 1) / WORKGROUPS_FLAT);
-  GLuint gY = (GLuint)((endY - baseY + WORKGROUPS_FLAT - 1) / WORKGROUPS_FLAT);
-
-  // Dispatch the merge. No glFinish per step: consecutive subtractions have a RAW
-  // hazard on obj1_flat handled by the SSBO barrier, so they pipeline without CPU
-  // stalls. The final CPU-visible sync happens once in subtractGPU_copyback().
-  glDispatchCompute(gX, gY, 1);
-  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+  long w2 = active->obj.params.resolutionXYZ.x;
+  long h2 = active->obj.params.resolutionXYZ.y;
+
+  shader_flat->use();  // the swept/copyback shaders may have been bound since the last batch
+  for (size_t i = 0; i < count; ++i) {
+    const glm::ivec3 offset = offsets[i];
+    // Stamping the same voxel offset twice in a row removes nothing more.
+    if (i > 0 && offset == offsets[i - 1]) continue;
+
+    glm::vec3 translate(w1 / 2 + offset.x, h1 / 2 + offset.y, z1 / 2 - offset.z);
+
+    // Restrict the dispatch to the tool's bounding box in workpiece space: threads
+    // outside the tool AOI would only early-return, so don't even launch them. The
+    // tool covers [t - w2/2, t - w2/2 + w2), odd widths included (as subtractSwept).
+    long baseX = glm::clamp((long)translate.x - w2 / 2, 0L, w1);
+    long baseY = glm::clamp((long)translate.y - h2 / 2, 0L, h1);
+    long endX = glm::clamp((long)translate.x - w2 / 2 + w2, 0L, w1);
+    long endY = glm::clamp((long)translate.y - h2 / 2 + h2, 0L, h1);
+    if (endX <= baseX || endY <= baseY) continue;  // tool fully outside the workpiece
+    shader_flat->setIVec3("translate", translate);
+    shader_flat->setInt("baseX", (int)baseX);
+    shader_flat->setInt("baseY", (int)baseY);
+    GLuint gX = (GLuint)((endX - baseX + WORKGROUPS_FLAT - 1) / WORKGROUPS_FLAT);
+    GLuint gY = (GLuint)((endY - baseY + WORKGROUPS_FLAT - 1) / WORKGROUPS_FLAT);
+
+    // Dispatch the merge. No glFinish per step: consecutive subtractions have a RAW
+    // hazard on obj1_flat handled by the SSBO barrier, so they pipeline without CPU
+    // stalls. The final CPU-visible sync happens once in subtractGPU_copyback().
+    glDispatchCompute(gX, gY, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+  }
 
 #ifdef DEBUG_SPEED_OUTPUT
   auto end = std::chrono::high_resolution_clock::now();  // ====> End timing
   std::chrono::duration<double, std::milli> duration = end - start;
-  std::cout << "GPU dispatch took " << duration.count() << " ms\n";
+  std::cout << "GPU dispatch of " << count << " stamps took " << duration.count() << " ms\n";
 #endif
 
   return true;
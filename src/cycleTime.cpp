@@ -0,0 +1,86 @@
+#include "cycleTime.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Time to cover `len` starting at v0 and ending at v1 (both reachable), cruising
+// at most at vmax, with acceleration a > 0.
+static double trapezoidTime(double len, double v0, double v1, double vmax, double a) {
+  const double dAcc = (vmax * vmax - v0 * v0) / (2.0 * a);
+  const double dDec = (vmax * vmax - v1 * v1) / (2.0 * a);
+  if (dAcc + dDec <= len) return (vmax - v0) / a + (vmax - v1) / a + (len - dAcc - dDec) / vmax;
+  // Triangle: the peak speed is never reached.
+  const double vp = std::sqrt(std::max(0.0, (2.0 * a * len + v0 * v0 + v1 * v1) * 0.5));
+  return (vp - v0) / a + (vp - v1) / a;
+}
+
+CycleTimeReport estimateCycleTime(const CompiledToolpath& tp, const MachineLimits& limits, std::vector<double>* segmentEnd) {
+  CycleTimeReport r;
+  const size_t n = tp.size();
+  if (segmentEnd) segmentEnd->assign(n, 0.0);
+  if (n < 2) return r;
+  const size_t segs = n - 1;
+  r.segments = segs;
+
+  // Segment s ends at entry s + 1: length (mm) and cruise speed (mm/s).
+  auto segmentLength = [&](size_t s) { return glm::length(tp.position(s + 1) - tp.position(s)) * limits.lengthScale; };
+  auto segmentSpeed = [&](size_t s) {
+    const bool rapid = tp.motion(s + 1) == MotionMode::RAPID;
+    double feed = rapid ? limits.rapidRate : tp.feed[s + 1];
+    if (!rapid && limits.maxFeed > 0.0) feed = std::min(feed, limits.maxFeed);
+    return feed / 60.0;
+  };
+  auto account = [&](size_t s, double len, double dt, double& t) {
+    t += dt;
+    if (tp.motion(s + 1) == MotionMode::RAPID) {
+      r.rapidSeconds += dt;
+      r.rapidLength += len;
+    } else {
+      r.cutSeconds += dt;
+      r.cutLength += len;
+      if (dt == 0.0 && len > 0.0) ++r.zeroFeed;
+    }
+    if (segmentEnd) (*segmentEnd)[s + 1] = t;
+  };
+
+  const double a = limits.acceleration;
+  double t = 0.0;
+  if (a <= 0.0) {  // feed-limited only: one streaming pass, no per-segment storage
+    for (size_t s = 0; s < segs; ++s) {
+      const double len = segmentLength(s), v = segmentSpeed(s);
+      account(s, len, (len > 0.0 && v > 0.0) ? len / v : 0.0, t);
+    }
+    r.seconds = t;
+    return r;
+  }
+
+  std::vector<double> len(segs), vmax(segs);
+  std::vector<glm::vec3> dir(segs);
+  for (size_t s = 0; s < segs; ++s) {
+    len[s] = segmentLength(s);
+    vmax[s] = segmentSpeed(s);
+    const glm::vec3 d = tp.position(s + 1) - tp.position(s);
+    const float l = glm::length(d);
+    dir[s] = l > 0.0f ? d / l : glm::vec3(0.0f);
+  }
+
+  // Junction speeds (entry of segment s = exit of s - 1). The path starts and ends
+  // at rest; a corner keeps cos(turn angle) of the slower neighbour's speed, so a
+  // straight continuation is free and a right angle (or reversal) stops.
+  std::vector<double> vj(segs + 1, 0.0);
+  {
+    for (size_t s = 1; s < segs; ++s) {
+      const double c = glm::dot(dir[s - 1], dir[s]);
+      vj[s] = std::min(vmax[s - 1], vmax[s]) * std::max(0.0, c);
+    }
+    for (size_t s = 0; s < segs; ++s)  // forward: exits reachable by accelerating
+      vj[s + 1] = std::min(vj[s + 1], std::sqrt(vj[s] * vj[s] + 2.0 * a * len[s]));
+    for (size_t s = segs; s-- > 0;)  // backward: entries that can still brake in time
+      vj[s] = std::min(vj[s], std::sqrt(vj[s + 1] * vj[s + 1] + 2.0 * a * len[s]));
+  }
+
+  for (size_t s = 0; s < segs; ++s)
+    account(s, len[s], (len[s] > 0.0 && vmax[s] > 0.0) ? trapezoidTime(len[s], vj[s], vj[s + 1], vmax[s], a) : 0.0, t);
+  r.seconds = t;
+  return r;
+}
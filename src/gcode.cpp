@@ -65,15 +65,16 @@
 // The execution should proceed in "real time", meaning that the simulation should reflect the time it would take to execute the commands in a real machine.
 // The execution speed should be adjustable, allowing for faster or slower simulation speeds (global speed factor override).
 // The class should implements the following methods:
-// - `loadFile(const std::string &filename)`: Load a G-code file.
+// - `loadFile(const std::string &filename, const ToolpathOptions &opts, const std::string &cacheDir)`: Load a G-code file (compiled once, cached, see toolpath.hpp).
 // - `checkFile()`: Checks a loaded file (if any) for formal correctness.
-// - `parseLine(const std::string &line)`: Parse a single line of G-code.
-// - `executeCommand(const std::string &command)`: Execute a parsed G-code command.
+// - Parsing is done once, by `loadFile`, through the parallel parser in gcodeParser.{hpp,cpp}.
 // - `setSpeedFactor(double factor)`: Set the global speed factor for the simulation.
-// - `run()`: Start the simulation, processing commands in real time according to the speed factor, scrolling through the G-code file.
+// - `cycleTime()`: Analytic machining time of the whole program (cycleTime.hpp), no wall clock.
+// - `run()`: Start the real-time playback: the position follows the analytic time profile, scaled by the speed factor.
 // - `stop()`: Stop the simulation.
 // - `isRunning() const`: Check if the simulation is currently running.
 // - `getCurrentPosition() const`: Get the current position of the tool in the simulation.
+// - Stepping along the toolpath (the old jog API) is done by ToolpathCursor (toolpathCursor.hpp), lock-free and in batches.
 // - `getCurrentFeedRate() const`: Get the current feed rate of the tool in the simulation.
 // - `getCurrentSpindleSpeed() const`: Get the current spindle speed of the tool in the simulation.
 // - `getCurrentTool() const`: Get the current tool being used in the simulation.
@@ -84,154 +85,97 @@
 #include <algorithm>
 #include <chrono>
 #include <cmath>
-#include <fstream>
 #include <iostream>
-#include <map>
-#include <sstream>
-#include <thread>
 
-GCodeInterpreter::GCodeInterpreter() : running(false) {}
+static const char* motionCode(MotionMode m) {
+  switch (m) {
+    case MotionMode::RAPID: return "G0";
+    case MotionMode::ARC_CW: return "G2";
+    case MotionMode::ARC_CCW: return "G3";
+    default: return "G1";
+  }
+}
+
+GCodeInterpreter::GCodeInterpreter() {}
 
 GCodeInterpreter::~GCodeInterpreter() { stop(); }
 
-bool GCodeInterpreter::loadFile(const std::string& filename) {
-  std::ifstream file(filename);
-  if (!file.is_open()) return false;
-  std::string line;
-  gcodeLines.clear();
-  while (std::getline(file, line)) {
-    gcodeLines.push_back(line);
+bool GCodeInterpreter::loadFile(const std::string& filename, const ToolpathOptions& opts, const std::string& cacheDir) {
+  parseStats = GcodeParseStats();
+  if (!compileToolpath(filename, toolpath, opts, cacheDir, &parseStats, &fromCache)) return false;
+
+  if (verbose) {
+    for (size_t i = 0; i < toolpath.size(); ++i) {
+      std::cout << "Line " << toolpath.line[i] << ": " << motionCode(toolpath.motion(i)) << " -> (" << toolpath.x[i]
+                << ", " << toolpath.y[i] << ", " << toolpath.z[i] << ") F" << toolpath.feed[i] << " T" << toolpath.tool[i] << std::endl;
+    }
   }
-  file.close();
   return true;
 }
 
-bool GCodeInterpreter::checkFile() const {
-  for (const auto& line : gcodeLines) {
-    if (line.find("G0") != std::string::npos || line.find("G1") != std::string::npos) return true;
-  }
-  return false;
-}
+bool GCodeInterpreter::checkFile() const { return !toolpath.empty(); }
 
 void GCodeInterpreter::setSpeedFactor(double factor) {
   std::lock_guard<std::mutex> lock(stateMutex);
+  if (running) {  // re-anchor so the program time stays continuous
+    anchorTime = playbackTime();
+    anchorWall = std::chrono::steady_clock::now();
+  }
   state.speedFactor = factor;
 }
 
 void GCodeInterpreter::run() {
-  if (running) return;
+  std::lock_guard<std::mutex> lock(stateMutex);
+  if (running || toolpath.empty()) return;
+  estimateCycleTime(toolpath, machineLimits, &segmentEnd);
+  anchorTime = 0.0;
+  anchorWall = std::chrono::steady_clock::now();
   running = true;
-  simulationThread = std::thread([this]() {
-    for (const auto& line : gcodeLines) {
-      if (!running) break;
-      executeCommand(line);
-    }
-    running = false;
-  });
+  seekPlayback(0.0);
 }
 
-void GCodeInterpreter::beginJog() {
-
-  toolpath = getToolpath();  // Get full toolpath for jogging
-
-  //@@@DEBUG
-  // std::cout << "Toolpath points:" << std::endl;
-  // for (size_t i = 0; i < std::min<size_t>(100, toolpath.size()); ++i) {
-  //   const auto& pt = toolpath[i];
-  //   std::cout << "  [" << i << "] (" << pt.position.x << ", " << pt.position.y << ", " << pt.position.z << ")" << std::endl;
-  // }
-  //@@@END DEBUG
-
-  jogCurrentPoint = 0;
-  jogCurrentPoint = 0;
-  jogAccumulatedDistance = 0.0f;
-  jogActive = true;
-  jogInitialized = true;
+double GCodeInterpreter::playbackTime() const {
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - anchorWall).count();
+  return anchorTime + elapsed * state.speedFactor;
 }
 
-void GCodeInterpreter::jog(float delta) {
-  if (!jogInitialized) {
-    beginJog();
-  }
-
-  // If we've completed all toolpath points, stop jogging
-  if (jogCurrentPoint >= toolpath.size()) {
-    jogActive = false;
-    return;
-  }
-
-  // If we need to parse a new command
-  if (toolpath.empty()) {
-    return;
-  }
-
-  // Process current segment
-  const glm::vec3& startPos = toolpath[jogCurrentPoint].position;
-  const glm::vec3& endPos = toolpath[jogCurrentPoint + 1].position;
-  glm::vec3 segment = endPos - startPos;
-  float segmentLength = glm::length(segment);
-
-  // Handle coincident points (zero-length segment)
-  if (segmentLength < 1e-6f) {
-    jogCurrentPoint++;
-    jogAccumulatedDistance = 0.0f;
-    // If at the end, complete jogging
-    if (jogCurrentPoint + 1 >= toolpath.size()) {
-      jogComplete();
-    }
+void GCodeInterpreter::seekPlayback(double t) const {
+  // Entry i is reached at segmentEnd[i]; within a segment the position is
+  // interpolated linearly in time.
+  const size_t i = std::upper_bound(segmentEnd.begin(), segmentEnd.end(), t) - segmentEnd.begin();
+  if (i >= segmentEnd.size()) {
+    state.position = toolpath.position(toolpath.size() - 1);
+    running = false;
     return;
   }
-
-  float remainingDistance = segmentLength - jogAccumulatedDistance;
-  float moveDistance = glm::min(delta, remainingDistance);
-  float t = (jogAccumulatedDistance + moveDistance) / segmentLength;
-  glm::vec3 newPosition = glm::mix(startPos, endPos, t);
-
-  // Update state
-  {
-    std::lock_guard<std::mutex> lock(stateMutex);
-    state.position = newPosition;  //%%%%
-  }
-
-  jogAccumulatedDistance += moveDistance;
-
-  // Move to next segment if completed
-  if (jogAccumulatedDistance >= segmentLength - 0.0001f) {
-    jogCurrentPoint++;
-    jogAccumulatedDistance = 0.0f;
-
-    //%%%%%%
-    // if (jogCurrentPoint + 1 >= toolpath.size()) {
-    //   jogComplete();
-    // }
-  }
+  const double t0 = segmentEnd[i - 1], t1 = segmentEnd[i];
+  const float f = t1 > t0 ? (float)((t - t0) / (t1 - t0)) : 1.0f;
+  state.position = glm::mix(toolpath.position(i - 1), toolpath.position(i), f);
+  state.feedRate = toolpath.feed[i];
+  state.tool = toolpath.tool[i];
 }
 
-bool GCodeInterpreter::jogComplete() const {
-  // Only complete if we've processed all commands AND all segments
-  return jogInitialized && (jogCurrentPoint + 1 >= toolpath.size());
-}
-
-void GCodeInterpreter::resetJog() {
-  jogInitialized = false;
-  jogActive = false;
-}
-// ----------------------------------------------------------------------------
 
 void GCodeInterpreter::stop() {
+  std::lock_guard<std::mutex> lock(stateMutex);
+  syncPlayback();  // freeze where the playback is now
   running = false;
-  if (simulationThread.joinable()) simulationThread.join();
 }
 
-bool GCodeInterpreter::isRunning() const { return running; }
+bool GCodeInterpreter::isRunning() const {
+  std::lock_guard<std::mutex> lock(stateMutex);
+  return running && playbackTime() < segmentEnd.back();
+}
 
 glm::vec3 GCodeInterpreter::getCurrentPosition() const {
   std::lock_guard<std::mutex> lock(stateMutex);
+  syncPlayback();
   return state.position;
 }
 
 double GCodeInterpreter::getCurrentFeedRate() const {
   std::lock_guard<std::mutex> lock(stateMutex);
+  syncPlayback();
   return state.feedRate;
 }
 
@@ -242,6 +186,7 @@ double GCodeInterpreter::getCurrentSpindleSpeed() const {
 
 int GCodeInterpreter::getCurrentTool() const {
   std::lock_guard<std::mutex> lock(stateMutex);
+  syncPlayback();
   return state.tool;
 }
 
@@ -249,222 +194,3 @@ Plane GCodeInterpreter::getCurrentPlane() const {
   std::lock_guard<std::mutex> lock(stateMutex);
   return state.currentPlane;
 }
-
-void GCodeInterpreter::parseLine(const std::string& line, std::map<char, double>& params, std::string& cmd) {
-  std::istringstream ss(line);
-  std::string token;
-  while (ss >> token) {
-    char letter = token[0];
-    std::string valueStr = token.substr(1);
-    if (letter == 'G' || letter == 'M') {
-      cmd = token;
-    } else {
-      try {
-        double value = std::stod(valueStr);
-        params[letter] = value;
-      } catch (...) {
-      }
-    }
-  }
-}
-
-/*
-void GCodeInterpreter::executeCommand(const std::string& line) {
-  std::map<char, double> params;
-  std::string cmd;
-  parseLine(line, params, cmd);
-
-  if (cmd == "G0" || cmd == "G1") {
-    glm::vec3 startPos;
-    double currentFeedRate;
-    double speedFactor;
-
-    {
-      std::lock_guard<std::mutex> lock(stateMutex);
-      startPos = state.position;
-      currentFeedRate = state.feedRate;
-      speedFactor = state.speedFactor;
-    }
-
-    glm::vec3 targetPos = startPos;
-    if (params.count('X')) targetPos.x = static_cast<float>(params['X']);
-    if (params.count('Y')) targetPos.y = static_cast<float>(params['Y']);
-    if (params.count('Z')) targetPos.z = static_cast<float>(params['Z']);
-
-    if (params.count('F')) {
-      std::lock_guard<std::mutex> lock(stateMutex);
-      state.feedRate = params['F'];
-      currentFeedRate = state.feedRate;
-    }
-
-    double distance = glm::length(targetPos - startPos);
-    double timeSeconds = (cmd == "G0") ? distance / 5000.0 : distance / (currentFeedRate / 60.0);
-    timeSeconds /= speedFactor;
-
-    const double stepTime = 0.01;
-    int steps = std::max(1, static_cast<int>(timeSeconds / stepTime));
-    for (int i = 1; i <= steps && running; ++i) {
-      double t = static_cast<double>(i) / steps;
-      glm::vec3 interpolated = glm::mix(startPos, targetPos, static_cast<float>(t));
-      {
-        std::lock_guard<std::mutex> lock(stateMutex);
-        state.position = interpolated;
-      }
-      std::this_thread::sleep_for(std::chrono::duration<double>(timeSeconds / steps));
-    }
-
-    {
-      std::lock_guard<std::mutex> lock(stateMutex);
-      state.position = targetPos;
-    }
-
-  } else if (cmd == "G4") {
-    double dwell = params.count('P') ? params['P'] : 0;
-    double localSpeed;
-    {
-      std::lock_guard<std::mutex> lock(stateMutex);
-      localSpeed = state.speedFactor;
-    }
-    std::this_thread::sleep_for(std::chrono::duration<double>(dwell / 1000.0 / localSpeed));
-  } else if (cmd == "G17") {
-    std::lock_guard<std::mutex> lock(stateMutex);
-    state.currentPlane = Plane::XY;
-  } else if (cmd == "G18") {
-    std::lock_guard<std::mutex> lock(stateMutex);
-    state.currentPlane = Plane::ZX;
-  } else if (cmd == "G19") {
-    std::lock_guard<std::mutex> lock(stateMutex);
-    state.currentPlane = Plane::YZ;
-  } else if (cmd == "M6" && params.count('T')) {
-    std::lock_guard<std::mutex> lock(stateMutex);
-    state.tool = static_cast<int>(params['T']);
-  } else if (params.count('S')) {
-    std::lock_guard<std::mutex> lock(stateMutex);
-    state.spindleSpeed = params['S'];
-  }
-}
-*/
-
-void GCodeInterpreter::executeCommand(const std::string& line) {
-  std::map<char, double> params;
-  std::string cmd;
-  parseLine(line, params, cmd);
-
-  if (verbose) {
-    std::cout << "Executing command: " << cmd << std::endl;
-    for (const auto& p : params) {
-      std::cout << "  Param " << p.first << " = " << p.second << std::endl;
-    }
-  }
-
-  if (cmd.empty() || line.empty() || line[0] == ';' || line[0] == '(') {
-    // Comment or empty line, nothing to do
-    return;
-  }
-
-  if (cmd == "G0" || cmd == "G1") {
-    glm::vec3 startPos;
-    double currentFeedRate;
-    double speedFactor;
-    // int currentTool;
-    // double spindleSpeed;
-
-    {
-      std::lock_guard<std::mutex> lock(stateMutex);
-      startPos = state.position;
-      currentFeedRate = state.feedRate;
-      speedFactor = state.speedFactor;
-      // currentTool = state.tool;
-      // spindleSpeed = state.spindleSpeed;
-    }
-
-    glm::vec3 targetPos = startPos;
-    if (params.count('X')) targetPos.x = static_cast<float>(params['X']);
-    if (params.count('Y')) targetPos.y = static_cast<float>(params['Y']);
-    if (params.count('Z')) targetPos.z = static_cast<float>(params['Z']);
-
-    if (params.count('F')) {
-      std::lock_guard<std::mutex> lock(stateMutex);
-      state.feedRate = params['F'];
-      currentFeedRate = state.feedRate;
-    }
-
-    // Store the toolpath point if previewing
-    if (previewMode) {
-      toolpath.push_back({
-          .position = targetPos
-          // .start = startPos,
-          // .end = targetPos,
-          // .feedRate = currentFeedRate,
-          // .tool = currentTool,
-          // .spindleSpeed = spindleSpeed
-      });
-    }
-
-    // Simulated movement (if not in preview mode)
-    double distance = glm::length(targetPos - startPos);
-    double timeSeconds = (cmd == "G0") ? distance / 5000.0 : distance / (currentFeedRate / 60.0);
-    timeSeconds /= speedFactor;
-
-    const double stepTime = 0.01;
-    int steps = std::max(1, static_cast<int>(timeSeconds / stepTime));
-
-    for (int i = 1; i <= steps && running && !previewMode; ++i) {
-      double t = static_cast<double>(i) / steps;
-      glm::vec3 interpolated = glm::mix(startPos, targetPos, static_cast<float>(t));
-      {
-        std::lock_guard<std::mutex> lock(stateMutex);
-        state.position = interpolated;  //%%%%%%%
-      }
-      std::this_thread::sleep_for(std::chrono::duration<double>(timeSeconds / steps));
-    }
-
-    {
-      std::lock_guard<std::mutex> lock(stateMutex);
-      state.position = targetPos;
-    }
-
-  } else if (cmd == "G4") {
-    double dwell = params.count('P') ? params['P'] : 0;
-    double localSpeed;
-    {
-      std::lock_guard<std::mutex> lock(stateMutex);
-      localSpeed = state.speedFactor;
-    }
-    if (!previewMode) std::this_thread::sleep_for(std::chrono::duration<double>(dwell / 1000.0 / localSpeed));
-
-  } else if (cmd == "G17") {
-    std::lock_guard<std::mutex> lock(stateMutex);
-    state.currentPlane = Plane::XY;
-  } else if (cmd == "G18") {
-    std::lock_guard<std::mutex> lock(stateMutex);
-    state.currentPlane = Plane::ZX;
-  } else if (cmd == "G19") {
-    std::lock_guard<std::mutex> lock(stateMutex);
-    state.currentPlane = Plane::YZ;
-  } else if (cmd == "M6" && params.count('T')) {
-    std::lock_guard<std::mutex> lock(stateMutex);
-    state.tool = static_cast<int>(params['T']);
-  } else if (params.count('S')) {
-    std::lock_guard<std::mutex> lock(stateMutex);
-    state.spindleSpeed = params['S'];
-  }
-}
-
-std::vector<GcodePoint> GCodeInterpreter::getToolpath() {
-  this->toolpath.clear();
-  glm::vec3 savedPosition = state.position;  // preserve state
-  bool wasRunning = running;
-
-  previewMode = true;
-  for (const auto& line : gcodeLines) {
-    if (verbose) std::cout << line << std::endl;
-    executeCommand(line);  // reuses actual logic
-  }
-  previewMode = false;
-
-  state.position = savedPosition;  // restore state
-  running = wasRunning;            // restore running state
-
-  return toolpath;
-}
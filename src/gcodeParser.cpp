@@ -0,0 +1,536 @@
+#include "gcodeParser.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+#define GCODE_MIN_CHUNK (256 * 1024)  // don't split programs in chunks smaller than 256 KB
+#define GCODE_MAX_CODES 8             // G (and M) codes kept per block
+#define GCODE_DEFAULT_FEED 1000.0f    // same default as SimulationState::feedRate
+#define GCODE_STREAM_WINDOW (256 * 1024)  // parseGcodeStream() window (one batch per window)
+#define GCODE_MAX_ARC_SEGMENTS 100000     // chords per arc, whatever the tolerance
+
+namespace {
+
+// -----------------------------------------------------------------------------
+// Word table: the words of one block, indexed by letter.
+// -----------------------------------------------------------------------------
+struct WordTable {
+  uint32_t mask = 0;  // bit (letter - 'A') set if the word is present
+  double value[26];
+  uint8_t numG = 0, numM = 0;
+  int32_t g[GCODE_MAX_CODES];  // G codes x10 (G54.1 -> 541)
+  int32_t m[GCODE_MAX_CODES];
+
+  bool has(char c) const { return mask & (1u << (c - 'A')); }
+  double operator[](char c) const { return value[c - 'A']; }
+};
+
+inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+// Read the words of the line [p, e) into `w`. Comments "( ... )" and "; ..." are
+// skipped; a letter not followed by a number (e.g. '%', stray text) is ignored.
+// With `blockDelete` a line starting with '/' reads as empty.
+void readWords(const char* p, const char* e, WordTable& w, bool blockDelete) {
+  w.mask = 0;
+  w.numG = w.numM = 0;
+  while (p < e && isBlank(*p)) ++p;
+  if (blockDelete && p < e && *p == '/') return;
+  while (p < e) {
+    char c = *p;
+    if (c == ';') return;
+    if (c == '(') {
+      p = static_cast<const char*>(std::memchr(p, ')', (size_t)(e - p)));
+      if (!p) return;
+      ++p;
+      continue;
+    }
+    if (c >= 'a' && c <= 'z') c = (char)(c - 'a' + 'A');
+    if (c < 'A' || c > 'Z') {
+      ++p;  // blanks, '%', '/', ...
+      continue;
+    }
+
+    ++p;
+    while (p < e && isBlank(*p)) ++p;
+    if (p < e && *p == '+') ++p;  // from_chars rejects an explicit '+'
+    double v;
+    auto res = std::from_chars(p, e, v);
+    if (res.ec != std::errc()) continue;
+    p = res.ptr;
+
+    if (c == 'G') {
+      if (w.numG < GCODE_MAX_CODES) w.g[w.numG++] = (int32_t)std::lround(v * 10.0);
+    } else if (c == 'M') {
+      if (w.numM < GCODE_MAX_CODES) w.m[w.numM++] = (int32_t)std::lround(v * 10.0);
+    } else {
+      w.mask |= 1u << (c - 'A');
+      w.value[c - 'A'] = v;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Compact block: only what the resolution passes need.
+// -----------------------------------------------------------------------------
+enum BlockFlags : uint32_t {
+  BF_X = 1u << 0,
+  BF_Y = 1u << 1,
+  BF_Z = 1u << 2,
+  BF_F = 1u << 3,
+  BF_T = 1u << 4,
+  BF_M6 = 1u << 5,
+  BF_MOTION = 1u << 6,            // the block sets the motion mode
+  BF_PLANE = 1u << 7,             // the block selects a plane
+  BF_NONMOTION_AXES = 1u << 8,    // G28/G30: X/Y/Z are not a move
+  BF_I = 1u << 9,                 // arc centre offsets (BF_I << axis)
+  BF_J = 1u << 10,
+  BF_K = 1u << 11,
+  BF_R = 1u << 12,                // arc radius
+  BF_ABSOLUTE = 1u << 13,         // G90
+  BF_INCREMENTAL = 1u << 14,      // G91
+  BF_INCH = 1u << 15,             // G20
+  BF_MM = 1u << 16,               // G21
+  BF_WCS = 1u << 17,              // G54..G59 (Block::wcs)
+  BF_MACHINE = 1u << 18,          // G53: this block's X/Y/Z are machine coordinates
+  BF_SET_WCS = 1u << 19,          // G10 L2/L20 P (Block::wcs, Block::l)
+  BF_G92 = 1u << 20,              // G92: the current position becomes X/Y/Z
+  BF_G92_CLEAR = 1u << 21,        // G92.1/G92.2
+  BF_ARC_ABSOLUTE = 1u << 22,     // G90.1: I/J/K are absolute
+  BF_ARC_INCREMENTAL = 1u << 23,  // G91.1: I/J/K are relative to the start (default)
+  BF_AXES = BF_X | BF_Y | BF_Z,
+  BF_ARC = BF_I | BF_J | BF_K | BF_R,
+  BF_NOT_A_MOVE = BF_NONMOTION_AXES | BF_SET_WCS | BF_G92,
+};
+
+struct Block {
+  uint32_t line = 0;  // 0-based within the chunk
+  uint32_t flags = 0;
+  double xyz[3];
+  double ijk[3];
+  double r;
+  float feed;
+  int32_t tool;
+  MotionMode motion;
+  Plane plane;
+  int8_t wcs;  // G54..G59 -> 0..5 (G10: P1..P6 -> 0..5, P0 -> -1 = active)
+  int8_t l;    // G10 L word
+};
+
+// Translate a word table into a compact block. Returns false if the block has
+// nothing the passes below care about.
+bool toBlock(const WordTable& w, Block& b, size_t& unsupported) {
+  b.flags = 0;
+  for (int i = 0; i < w.numG; ++i) {
+    const int32_t g = w.g[i];
+    switch (g) {
+      case 0: b.flags |= BF_MOTION, b.motion = MotionMode::RAPID; break;
+      case 10: b.flags |= BF_MOTION, b.motion = MotionMode::LINEAR; break;
+      case 20: b.flags |= BF_MOTION, b.motion = MotionMode::ARC_CW; break;
+      case 30: b.flags |= BF_MOTION, b.motion = MotionMode::ARC_CCW; break;
+      case 800: b.flags |= BF_MOTION, b.motion = MotionMode::NONE; break;
+      case 170: b.flags |= BF_PLANE, b.plane = Plane::XY; break;
+      case 180: b.flags |= BF_PLANE, b.plane = Plane::ZX; break;
+      case 190: b.flags |= BF_PLANE, b.plane = Plane::YZ; break;
+      case 200: b.flags |= BF_INCH; break;
+      case 210: b.flags |= BF_MM; break;
+      case 900: b.flags |= BF_ABSOLUTE; break;
+      case 910: b.flags |= BF_INCREMENTAL; break;
+      case 901: b.flags |= BF_ARC_ABSOLUTE; break;
+      case 911: b.flags |= BF_ARC_INCREMENTAL; break;
+      case 530: b.flags |= BF_MACHINE; break;
+      case 540:
+      case 550:
+      case 560:
+      case 570:
+      case 580:
+      case 590: b.flags |= BF_WCS, b.wcs = (int8_t)((g - 540) / 10); break;
+      case 920: b.flags |= BF_G92; break;
+      case 921:
+      case 922: b.flags |= BF_G92_CLEAR; break;
+      case 100: {
+        const int l = w.has('L') ? (int)std::lround(w['L']) : 0;
+        const int p = w.has('P') ? (int)std::lround(w['P']) : 0;
+        if ((l == 2 || l == 20) && p >= 0 && p <= 6) {
+          b.flags |= BF_SET_WCS, b.l = (int8_t)l, b.wcs = (int8_t)(p - 1);
+        } else {
+          b.flags |= BF_NONMOTION_AXES;  // tool/other tables: not modelled
+          ++unsupported;
+        }
+        break;
+      }
+      case 40: break;  // dwell: no motion, no modal change
+      case 280:
+      case 300: b.flags |= BF_NONMOTION_AXES; break;
+      default: ++unsupported; break;
+    }
+  }
+  for (int i = 0; i < w.numM; ++i)
+    if (w.m[i] == 60) b.flags |= BF_M6;
+
+  if (w.has('X')) b.flags |= BF_X, b.xyz[0] = w['X'];
+  if (w.has('Y')) b.flags |= BF_Y, b.xyz[1] = w['Y'];
+  if (w.has('Z')) b.flags |= BF_Z, b.xyz[2] = w['Z'];
+  if (w.has('I')) b.flags |= BF_I, b.ijk[0] = w['I'];
+  if (w.has('J')) b.flags |= BF_J, b.ijk[1] = w['J'];
+  if (w.has('K')) b.flags |= BF_K, b.ijk[2] = w['K'];
+  if (w.has('R')) b.flags |= BF_R, b.r = w['R'];
+  if (w.has('F')) b.flags |= BF_F, b.feed = (float)w['F'];
+  if (w.has('T')) b.flags |= BF_T, b.tool = (int32_t)std::lround(w['T']);
+  return b.flags != 0;
+}
+
+// -----------------------------------------------------------------------------
+// Modal state machine. Positions are machine coordinates in millimetres:
+//   machine = program * unit + workOffset[wcs] + g92      (G90)
+//   machine += program * unit                             (G91)
+// -----------------------------------------------------------------------------
+struct Modal {
+  MotionMode motion = MotionMode::NONE;
+  Plane plane = Plane::XY;
+  bool incremental = false;  // G91
+  bool inches = false;       // G20
+  bool arcAbsolute = false;  // G90.1
+  int8_t wcs = 0;            // G54
+  float feed = GCODE_DEFAULT_FEED;  // mm/min
+  int32_t tool = 0;
+  int32_t pending = 0;  // T word (tool selected for the next M6)
+  double pos[3] = {0.0, 0.0, 0.0};
+  double workOffset[6][3] = {};  // G54..G59, set by G10 L2/L20
+  double g92[3] = {0.0, 0.0, 0.0};
+
+  double unit() const { return inches ? 25.4 : 1.0; }
+  // Machine coordinate of program coordinate `v` on `axis` (absolute mode).
+  double toMachine(int axis, double v) const { return v * unit() + workOffset[wcs][axis] + g92[axis]; }
+};
+
+inline bool isArc(MotionMode m) { return m == MotionMode::ARC_CW || m == MotionMode::ARC_CCW; }
+
+// Apply `b` to `s` in RS-274 execution order (feed, tool, units, plane, distance
+// mode, coordinate system, non-modal settings, motion). Returns true if the
+// block moves the tool.
+bool applyBlock(Modal& s, const Block& b) {
+  if (b.flags & BF_INCH) s.inches = true;
+  if (b.flags & BF_MM) s.inches = false;
+  if (b.flags & BF_F) s.feed = (float)(b.feed * s.unit());
+  if (b.flags & BF_T) s.pending = b.tool;
+  if (b.flags & BF_M6) s.tool = s.pending;
+  if (b.flags & BF_PLANE) s.plane = b.plane;
+  if (b.flags & BF_ABSOLUTE) s.incremental = false;
+  if (b.flags & BF_INCREMENTAL) s.incremental = true;
+  if (b.flags & BF_ARC_ABSOLUTE) s.arcAbsolute = true;
+  if (b.flags & BF_ARC_INCREMENTAL) s.arcAbsolute = false;
+  if (b.flags & BF_WCS) s.wcs = b.wcs;
+  if (b.flags & BF_MOTION) s.motion = b.motion;
+  if (b.flags & BF_G92_CLEAR) s.g92[0] = s.g92[1] = s.g92[2] = 0.0;
+
+  if (b.flags & BF_SET_WCS) {
+    double* off = s.workOffset[b.wcs < 0 ? s.wcs : b.wcs];
+    for (int a = 0; a < 3; ++a) {
+      if (!(b.flags & (BF_X << a))) continue;
+      const double v = b.xyz[a] * s.unit();
+      off[a] = (b.l == 2) ? v : s.pos[a] - s.g92[a] - v;  // L20: the current position becomes v
+    }
+  }
+  if (b.flags & BF_G92) {
+    for (int a = 0; a < 3; ++a)
+      if (b.flags & (BF_X << a)) s.g92[a] = s.pos[a] - s.workOffset[s.wcs][a] - b.xyz[a] * s.unit();
+  }
+  if (b.flags & BF_NOT_A_MOVE) return false;
+
+  if (!(b.flags & BF_AXES)) return isArc(s.motion) && (b.flags & BF_ARC);  // full circle: "G2 I5"
+  for (int a = 0; a < 3; ++a) {
+    if (!(b.flags & (BF_X << a))) continue;
+    if (b.flags & BF_MACHINE)
+      s.pos[a] = b.xyz[a] * s.unit();
+    else if (s.incremental)
+      s.pos[a] += b.xyz[a] * s.unit();
+    else
+      s.pos[a] = s.toMachine(a, b.xyz[a]);
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// Arcs (G2/G3): chords whose sagitta is at most the tolerance.
+// -----------------------------------------------------------------------------
+
+// In-plane axes (a0, a1) and normal axis of a plane; G2/G3 turn around the normal.
+inline void planeAxes(Plane p, int& a0, int& a1, int& an) {
+  switch (p) {
+    case Plane::XY: a0 = 0, a1 = 1, an = 2; break;
+    case Plane::ZX: a0 = 2, a1 = 0, an = 1; break;
+    case Plane::YZ: a0 = 1, a1 = 2, an = 0; break;
+  }
+}
+
+// Tessellate the arc of block `b` (state `s` after the block) from `from` to `to`
+// and call point(p) for the end of every chord (the last one is `to`). The centre
+// comes from I/J/K (relative to the start, or absolute after G90.1) or from R
+// (negative R: the arc > 180 deg); the normal axis moves linearly (helix).
+// Degenerate arcs become one line. Returns the number of points.
+template <typename Fn>
+size_t tessellateArc(const double from[3], const double to[3], const Block& b, const Modal& s, double tol, Fn&& point) {
+  const bool ccw = s.motion == MotionMode::ARC_CCW;
+  int a0, a1, an;
+  planeAxes(s.plane, a0, a1, an);
+  const double s0 = from[a0], s1 = from[a1], e0 = to[a0], e1 = to[a1];
+
+  double c0, c1;
+  if (b.flags & BF_R) {
+    const double d0 = e0 - s0, d1 = e1 - s1, d = std::hypot(d0, d1);
+    if (d < 1e-12) {
+      point(to);
+      return 1;
+    }
+    const double r = b.r * s.unit();
+    const double h = std::sqrt(std::max(0.0, r * r - d * d / 4.0));
+    const double side = (ccw ? 1.0 : -1.0) * (r < 0.0 ? -1.0 : 1.0);  // centre left (+) / right (-) of the chord
+    c0 = (s0 + e0) / 2.0 - side * h * d1 / d;
+    c1 = (s1 + e1) / 2.0 + side * h * d0 / d;
+  } else if (s.arcAbsolute) {
+    c0 = (b.flags & (BF_I << a0)) ? s.toMachine(a0, b.ijk[a0]) : s0;
+    c1 = (b.flags & (BF_I << a1)) ? s.toMachine(a1, b.ijk[a1]) : s1;
+  } else {
+    c0 = s0 + ((b.flags & (BF_I << a0)) ? b.ijk[a0] * s.unit() : 0.0);
+    c1 = s1 + ((b.flags & (BF_I << a1)) ? b.ijk[a1] * s.unit() : 0.0);
+  }
+
+  const double r0 = std::hypot(s0 - c0, s1 - c1), r1 = std::hypot(e0 - c0, e1 - c1);
+  if (r0 < 1e-9 || r1 < 1e-9) {
+    point(to);
+    return 1;
+  }
+  const double t0 = std::atan2(s1 - c1, s0 - c0), t1 = std::atan2(e1 - c1, e0 - c0);
+  const double twoPi = 2.0 * M_PI;
+  double sweep = ccw ? t1 - t0 : t0 - t1;
+  if (std::hypot(e0 - s0, e1 - s1) < 1e-9)
+    sweep = twoPi;  // same start and end: full circle
+  else
+    while (sweep <= 0.0) sweep += twoPi;
+
+  // Chord of angle a on radius r has sagitta r (1 - cos(a/2)).
+  const double r = std::max(r0, r1);
+  // A tolerance <= 0 (callers reject it; the parser must not divide by it) gets the segment cap.
+  const double maxAngle = (tol >= r) ? M_PI : tol > 0.0 ? 2.0 * std::acos(1.0 - tol / r) : 0.0;
+  const double want = maxAngle > 0.0 ? std::ceil(sweep / maxAngle) : (double)GCODE_MAX_ARC_SEGMENTS;
+  const size_t n = want < 1.0 ? 1 : want < (double)GCODE_MAX_ARC_SEGMENTS ? (size_t)want : GCODE_MAX_ARC_SEGMENTS;
+
+  const double dir = ccw ? 1.0 : -1.0;
+  double p[3];
+  for (size_t i = 1; i < n; ++i) {
+    const double t = (double)i / (double)n;
+    const double a = t0 + dir * sweep * t, ri = r0 + (r1 - r0) * t;  // r0 != r1: blend (rounded programs)
+    p[a0] = c0 + ri * std::cos(a);
+    p[a1] = c1 + ri * std::sin(a);
+    p[an] = from[an] + (to[an] - from[an]) * t;
+    point(p);
+  }
+  point(to);
+  return n;
+}
+
+struct Chunk {
+  const char* begin = nullptr;
+  const char* end = nullptr;
+  std::vector<Block> blocks;
+  size_t lines = 0;
+  size_t unsupported = 0;
+  // Filled by the prefix pass
+  Modal entry;
+  size_t firstLine = 0;
+  // Filled by the count pass
+  size_t points = 0;  // output entries (arcs count one per chord)
+  size_t arcs = 0;
+  size_t outOffset = 0;
+};
+
+// Pass 1: parse the chunk's text into compact blocks.
+void scanChunk(Chunk& c, bool blockDelete) {
+  WordTable w;
+  Block b;
+  size_t line = 0;
+  for (const char* p = c.begin; p < c.end; ++line) {
+    const char* eol = static_cast<const char*>(std::memchr(p, '\n', (size_t)(c.end - p)));
+    if (!eol) eol = c.end;
+    readWords(p, eol, w, blockDelete);
+    if (toBlock(w, b, c.unsupported)) {
+      b.line = (uint32_t)line;
+      c.blocks.push_back(b);
+    }
+    p = eol + 1;
+  }
+  c.lines = line;
+}
+
+// Replay the blocks from the (now known) entry state, calling
+// point(state, position, block) for every output entry. Returns the arc count.
+template <typename Fn>
+size_t replayChunk(const Chunk& c, const ToolpathOptions& opts, Fn&& point) {
+  Modal s = c.entry;
+  size_t arcs = 0;
+  for (const Block& b : c.blocks) {
+    double from[3] = {s.pos[0], s.pos[1], s.pos[2]};
+    if (!applyBlock(s, b) || s.motion == MotionMode::NONE) continue;
+    if (isArc(s.motion)) {
+      ++arcs;
+      tessellateArc(from, s.pos, b, s, opts.arcTolerance, [&](const double* p) { point(s, p, b); });
+    } else {
+      point(s, s.pos, b);
+    }
+  }
+  return arcs;
+}
+
+// Entry state of the next chunk: replay the compact blocks (no text, no output).
+// Incremental moves, G92 and G10 L20 depend on the position, so the state is
+// carried across chunks sequentially; it costs a few ns per kept block.
+void advanceState(Modal& s, const Chunk& c) {
+  for (const Block& b : c.blocks) applyBlock(s, b);
+}
+
+// Pass 2: count the output entries of a chunk.
+void countChunk(Chunk& c, const ToolpathOptions& opts) {
+  c.points = 0;
+  c.arcs = replayChunk(c, opts, [&](const Modal&, const double*, const Block&) { ++c.points; });
+}
+
+// Pass 3: write the chunk's entries at its output offset.
+void emitChunk(const Chunk& c, const ToolpathOptions& opts, CompiledToolpath& out) {
+  size_t o = c.outOffset;
+  replayChunk(c, opts, [&](const Modal& s, const double* p, const Block& b) {
+    out.x[o] = (float)p[0];
+    out.y[o] = (float)p[1];
+    out.z[o] = (float)p[2];
+    out.moveType[o] = static_cast<uint8_t>(s.motion);
+    out.feed[o] = s.feed;
+    out.tool[o] = s.tool;
+    out.line[o] = (uint32_t)(c.firstLine + b.line + 1);
+    ++o;
+  });
+}
+
+}  // namespace
+
+void parseGcodeBuffer(const char* data, size_t size, CompiledToolpath& out, const ToolpathOptions& opts, GcodeParseStats* stats,
+                      unsigned workers) {
+  auto t0 = std::chrono::high_resolution_clock::now();
+
+  // Line-aligned chunks.
+  size_t numChunks = std::max<size_t>(1, std::min<size_t>(std::max(1u, workers), size / GCODE_MIN_CHUNK));
+  std::vector<Chunk> chunks(numChunks);
+  const char* cut = data;
+  for (size_t i = 0; i < numChunks; ++i) {
+    chunks[i].begin = cut;
+    if (i + 1 == numChunks) {
+      cut = data + size;
+    } else {
+      const char* c = std::max(cut, data + size * (i + 1) / numChunks);
+      const char* nl = static_cast<const char*>(std::memchr(c, '\n', (size_t)(data + size - c)));
+      cut = nl ? nl + 1 : data + size;
+    }
+    chunks[i].end = cut;
+  }
+
+  parallelFor(numChunks, [&](size_t b, size_t e, unsigned) {
+    for (size_t i = b; i < e; ++i) scanChunk(chunks[i], opts.blockDelete);
+  });
+
+  // Prefix pass: entry modal state and first line of every chunk.
+  Modal state;
+  size_t line = 0;
+  for (Chunk& c : chunks) {
+    c.entry = state;
+    c.firstLine = line;
+    line += c.lines;
+    advanceState(state, c);
+  }
+
+  // Count (arcs expand to several chords), offsets, then write in place.
+  parallelFor(numChunks, [&](size_t b, size_t e, unsigned) {
+    for (size_t i = b; i < e; ++i) countChunk(chunks[i], opts);
+  });
+  size_t offset = 0;
+  for (Chunk& c : chunks) {
+    c.outOffset = offset;
+    offset += c.points;
+  }
+  out.resize(offset);
+  parallelFor(numChunks, [&](size_t b, size_t e, unsigned) {
+    for (size_t i = b; i < e; ++i) emitChunk(chunks[i], opts, out);
+  });
+
+  if (stats) {
+    *stats = GcodeParseStats();
+    stats->bytes = size;
+    stats->lines = line;
+    stats->moves = out.size();
+    stats->chunks = (unsigned)numChunks;
+    for (const Chunk& c : chunks) {
+      stats->blocks += c.blocks.size();
+      stats->arcs += c.arcs;
+      stats->unsupported += c.unsupported;
+    }
+    stats->ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+  }
+}
+
+void parseGcodeStream(const char* data, size_t size, const GcodeBatchSink& sink, const ToolpathOptions& opts, GcodeParseStats* stats,
+                      size_t windowBytes) {
+  auto t0 = std::chrono::high_resolution_clock::now();
+  if (windowBytes == 0) windowBytes = GCODE_STREAM_WINDOW;
+
+  // The windows are parsed one after the other (one scan + one emit each), so
+  // every window starts from the exact modal state left by the previous one.
+  Modal state;
+  size_t line = 0, moves = 0, blocks = 0, arcs = 0, unsupported = 0;
+  unsigned windows = 0;
+  std::vector<Block> blockBuf;  // reused across windows
+  CompiledToolpath batch;
+
+  for (const char* cut = data; cut < data + size; ++windows) {
+    Chunk c;
+    c.blocks.swap(blockBuf);
+    c.blocks.clear();
+    c.begin = cut;
+    if ((size_t)(data + size - cut) <= windowBytes) {
+      cut = data + size;
+    } else {
+      const char* nl = static_cast<const char*>(std::memchr(cut + windowBytes, '\n', (size_t)(data + size - cut - windowBytes)));
+      cut = nl ? nl + 1 : data + size;
+    }
+    c.end = cut;
+
+    scanChunk(c, opts.blockDelete);
+    c.entry = state;
+    c.firstLine = line;
+    countChunk(c, opts);
+    c.outOffset = 0;
+    batch.resize(c.points);
+    emitChunk(c, opts, batch);
+
+    line += c.lines;
+    moves += batch.size();
+    blocks += c.blocks.size();
+    arcs += c.arcs;
+    unsupported += c.unsupported;
+    advanceState(state, c);
+    blockBuf.swap(c.blocks);
+
+    if (!batch.empty() && !sink(batch)) break;
+  }
+
+  if (stats) {
+    *stats = GcodeParseStats();
+    stats->bytes = size;
+    stats->lines = line;
+    stats->moves = moves;
+    stats->blocks = blocks;
+    stats->arcs = arcs;
+    stats->unsupported = unsupported;
+    stats->chunks = windows;
+    stats->ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+  }
+}
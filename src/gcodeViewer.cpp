@@ -3,14 +3,16 @@
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
 
+#include <cmath>
 #include <iostream>
 #include <stdexcept>
 
 #include "boolOps.hpp"
 #include "meshLoader.hpp"
+#include "segmentClip.hpp"
 #include "shader.hpp"
 
-GcodeViewer::GcodeViewer(GLFWwindow* window, const std::vector<GcodePoint>& toolpath) : window(window), toolPosition(0.0f), path(toolpath) { init(); }
+GcodeViewer::GcodeViewer(GLFWwindow* window, const CompiledToolpath& toolpath) : window(window), toolPosition(0.0f), path(toolpath) { init(); }
 
 GcodeViewer::~GcodeViewer() {
   // Cleanup
@@ -105,13 +107,13 @@ void GcodeViewer::initToolpath() {
   if (toolPathInitialized) return;
 
   // Setup toolpath line VAO/VBO
-  std::vector<float> vertices;
-  for (const auto& pt : path) {
-    vertices.push_back(pt.position.x);
-    vertices.push_back(pt.position.y);
-    vertices.push_back(pt.position.z);
+  std::vector<float> vertices(path.size() * 3);
+  for (size_t i = 0; i < path.size(); ++i) {
+    vertices[3 * i + 0] = path.x[i];
+    vertices[3 * i + 1] = path.y[i];
+    vertices[3 * i + 2] = path.z[i];
   }
-  pathVertexCount = vertices.size() / 3;
+  pathVertexCount = path.size();
 
   glGenVertexArrays(1, &pathVAO);
   glGenBuffers(1, &pathVBO);
@@ -488,26 +490,44 @@ void GcodeViewer::setWorkpiece(std::string workpiecePath) { initVO(workpiecePath
 
 void GcodeViewer::setTool(std::string toolPath) { initVO(toolPath, VOType::TOOL); }
 
-void GcodeViewer::initVO(const std::string& path, VOType type) {
-  //@@@ Tool management
-  if (type == VOType::TOOL) {
-    if (ops.getObjects().size() > 1) {
-      std::cerr << "Tool already initialized. Only one tool can be set." << std::endl;
-      return;
-    }
-    if (ops.getObjects().size() == 0) {
-      std::cerr << "Set workpiece first." << std::endl;
-      return;
-    }
-    if (!ops.load(path)) {
-      std::cerr << "Failed to load tool object." << std::endl;
-      return;
-    }
-
-    std::cout << "Tool loaded: " << path << std::endl;
+bool GcodeViewer::addTool(int number, const std::string& toolPath) {
+  if (ops.getObjects().empty()) {
+    std::cerr << "Set workpiece first." << std::endl;
+    return false;
+  }
+  VoxelObject tool;
+  bool cached = false;
+  const bool loaded = toolVoxelSize.x > 0.0f ? loadResampledObject(toolPath, toolVoxelSize, toolResample, toolCacheDir, tool, &cached)
+                                             : BoolOps::loadObject(toolPath, tool);
+  if (!loaded) {
+    std::cerr << "Failed to load tool object: " << toolPath << std::endl;
+    return false;
+  }
+  if (cached)
+    std::cout << "Tool " << toolPath << " resampled to voxel size " << toolVoxelSize.x << " x " << toolVoxelSize.y << " x " << toolVoxelSize.z
+              << " (from cache)" << std::endl;
+  // The workpiece is uploaded once, with the first tool; later tools only add their own buffers.
+  if (ops.toolCount() == 0 && !ops.subtractGPU_init(ops.getObjects()[0])) return false;
+  if (!ops.addTool(std::move(tool), number)) return false;
+
+  if (number == BoolOps::DEFAULT_TOOL)
+    std::cout << "Tool loaded: " << toolPath << std::endl;
+  else
+    std::cout << "Tool T" << number << " loaded: " << toolPath << std::endl;
+  return true;
+}
 
-    ops.subtractGPU_init(ops.getObjects()[0], ops.getObjects()[1]);  //@@@ MOVE TO A MORE SUITED POSITION TO ALLOW RESET, TOOL CHANGE, ETC.
+bool GcodeViewer::selectTool(int number) {
+  if (number == selectedTool) return true;
+  if (selectedTool != INT_MIN) ++toolChanges;
+  selectedTool = number;
+  return ops.selectTool(number);
+}
 
+void GcodeViewer::initVO(const std::string& path, VOType type) {
+  // Tools go to the resident tool library (see addTool); this one is the default tool.
+  if (type == VOType::TOOL) {
+    addTool(BoolOps::DEFAULT_TOOL, path);
     return;
   }
 
@@ -527,7 +547,7 @@ void GcodeViewer::initVO(const std::string& path, VOType type) {
 
   // If the type is WORKPIECE, setup for visualization
   if (type == VOType::WORKPIECE) {
-    VoxelObject obj = ops.getObjects().back();  // Get the last object loaded (assumed to be the workpiece)
+    const VoxelObject& obj = ops.getObjects().back();  // Get the last object loaded (assumed to be the workpiece)
 
     // Extract workpiece object data
     params = obj.params;  // Get voxelization parameters from the last object
@@ -546,11 +566,8 @@ void GcodeViewer::initVO(const std::string& path, VOType type) {
     workpieceVO_compressedBuffer = 0;
     workpieceVO_prefixSumBuffer = 0;
 
-    std::vector<unsigned int> compressedData;
-    std::vector<unsigned int> prefixSumData;
-
-    compressedData = obj.compressedData;  // Get compressed data from the first object
-    prefixSumData = obj.prefixSumData;    // Get prefix sum data from the first object
+    const std::vector<unsigned int>& compressedData = obj.compressedData;  // Uploaded straight from the loaded object
+    const std::vector<unsigned int>& prefixSumData = obj.prefixSumData;
 
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
@@ -681,14 +698,64 @@ void GcodeViewer::carve(glm::vec3 pos) {
   glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, workpieceVO_prefixSumBuffer);
 }
 
-void GcodeViewer::carveSwept(glm::vec3 p0, glm::vec3 p1) {
+void GcodeViewer::carveBatch(const float* x, const float* y, const float* z, size_t count) {
+  // Same float -> voxel offset conversion as carve(); the scratch buffer only
+  // grows, so steady-state batches allocate nothing.
+  if (stampOffsets.size() < count) stampOffsets.resize(count);
+  const glm::ivec3 lift(0, 0, tipLift());
+  for (size_t i = 0; i < count; ++i) stampOffsets[i] = glm::ivec3(glm::vec3(x[i], y[i], z[i])) + lift;
+  ops.subtractGPU(stampOffsets.data(), count);
+
+  const long before = carvingCounter;
+  carvingCounter += (long)count;
+  if (carvingCounter / 64 != before / 64) printCounter(carvingCounter);
+}
+
+int GcodeViewer::tipLift() const {
+  // The kernels centre a tool on its own grid (z2 / 2 slices below the position).
+  const VoxelObject* tool = ops.activeTool();
+  return toolTipAtZ && tool ? tool->params.resolutionXYZ.z / 2 : 0;
+}
+
+bool GcodeViewer::carveSwept(glm::vec3 p0, glm::vec3 p1) {
+  const float lift = (float)tipLift();
+  p0.z += lift;
+  p1.z += lift;
+
+  // The segment's own lattice: start rounded once, K substeps along the dominant
+  // axis (as in BoolOps::subtractSwept).
+  const glm::ivec3 startOffset = glm::ivec3(glm::round(p0));
+  const glm::ivec3 displacement = glm::ivec3(glm::round(p1)) - startOffset;
+  const glm::ivec3 ad = glm::abs(displacement);
+  const int K = glm::max(glm::max(ad.x, ad.y), ad.z);
+  int firstSubstep = 0, lastSubstep = K;
+
+  // Clip the tool-centre segment (workpiece voxel offsets, +Z up) to the workpiece
+  // box inflated by the tool's half extents: outside it the tool cannot touch the
+  // workpiece. One extra voxel absorbs the endpoint rounding. A clipped segment only
+  // narrows the substep range, so it carves the same voxels as the whole segment.
+  const auto& objs = ops.getObjects();
+  if (!objs.empty() && ops.activeTool()) {
+    const glm::vec3 half = 0.5f * (glm::vec3(objs[0].params.resolutionXYZ) + glm::vec3(ops.activeTool()->params.resolutionXYZ)) + 1.0f;
+    glm::vec3 c0 = p0, c1 = p1;
+    glm::vec2 t;
+    switch (clipSegment(c0, c1, -half, half, &t)) {
+      case ClipResult::OUTSIDE: ++clipStats.dropped; return false;
+      case ClipResult::CLIPPED:
+        ++clipStats.clipped;
+        firstSubstep = glm::max(0, (int)std::floor(t.x * K));
+        lastSubstep = glm::min(K, (int)std::ceil(t.y * K));
+        break;
+      case ClipResult::INSIDE: break;
+    }
+  }
+
   // Subtract the volume swept by the tool along the segment p0 -> p1 in one dispatch.
-  glm::ivec3 startOffset = glm::ivec3(glm::round(p0));
-  glm::ivec3 displacement = glm::ivec3(glm::round(p1)) - startOffset;
-  ops.subtractSwept(startOffset, displacement);
+  ops.subtractSwept(startOffset, displacement, firstSubstep, lastSubstep);
 
   carvingCounter++;
   if (carvingCounter % 64 == 0) printCounter(carvingCounter);
+  return true;
 }
 
 void GcodeViewer::finishGPU() { glFinish(); }
\ No newline at end of file
@@ -27,16 +27,54 @@ void printUsage() {
       "Usage:\n"
       "  autocam <command> [options]\n\n"
       "Commands:\n"
-      "  voxelize <input.stl> [--out <file.bin>] [--res <float>] [--mem-mb <int>]\n"
-      "      Voxelize an STL mesh and save it as a .bin voxel object.\n"
+      "  voxelize <input.stl> [--out <file.bin>] [--res <float>] [--mem-mb <int>] [--backend gpu|twopass|cpu] [--tile <px>]\n"
+      "           [--zsub <n>] [--ram-mb <int>] [--plan]\n"
+      "      Voxelize an STL mesh and save it as a .bin voxel object (cpu: no GPU needed).\n"
+      "      --zsub slices Z n times finer than the XY voxel (fixed-point Z transitions).\n"
+      "      --plan prints the memory plan (peak RAM / VRAM per stage) and stops;\n"
+      "      --ram-mb and --mem-mb (VRAM) are the budgets it must fit.\n"
       "      Default output: test/<stlname>.bin\n\n"
+      "  voxelize-batch <dir|list.txt> [--out-dir <dir>] [--res <float>] [--mem-mb <int>]\n"
+      "                 [--backend gpu|twopass|cpu] [--tile <px>] [--zsub <n>] [--manifest <file.csv>] [--ram-mb <int>]\n"
+      "      Voxelize every mesh of a directory or list with one OpenGL context; writes a CSV manifest.\n"
+      "      Meshes whose memory plan exceeds --ram-mb / --mem-mb are skipped.\n\n"
+      "  generate <primitive>... [--out <file.bin>] [--res <float>] [--zsub <n>]\n"
+      "      Build a .bin from analytic primitives, e.g. box:100,100,50  ball:10,30  -cyl:20,10@0,0,40\n"
+      "      ([+|-]box:sx,sy,sz | cyl:d,l | flat:d,l | ball:d,l | bull:d,r,l | vbit:d,angle,l [@x,y,z]; no GPU).\n\n"
+      "  resample <in.bin> --res <float> [--zsub <n>] | --voxel <x,y,z> [--mode nearest|conservative] [--out <file.bin>]\n"
+      "      Convert a .bin to another (per-axis) voxel size by resampling its columns.\n\n"
       "  simulate --gcode <f.gcode> --workpiece <w.bin> --tool <t.bin>\n"
-      "           [--out <r.bin>] [--step <float>] [--perspective] [--no-view] [--legacy]\n"
+      "           [--out <r.bin>] [--runs <n>] [--step <float>] [--perspective] [--no-view] [--legacy]\n"
+      "           [--no-cache] [--stream] [--arc-tol <float>] [--units mm|voxel] [--simplify <float>]\n"
+      "           [--tools <T=t.bin,...>] [--rapid <mm/min>] [--accel <mm/s^2>] [--resample <mode>]\n"
+      "           [--ram-mb <int>] [--vram-mb <int>] [--plan] [--hugetlb]\n"
       "      Carve the workpiece along the G-code toolpath with the tool.\n"
-      "      --no-view runs headless (no window); --out saves the carved result.\n"
-      "      --legacy uses per-step stamping instead of the swept subtraction.\n\n"
+      "      --no-view runs headless (no window); --out saves the carved result\n"
+      "      (on a background writer). --runs repeats the simulation from the\n"
+      "      uncarved workpiece and reports results/s.\n"
+      "      --legacy uses per-step stamping instead of the swept subtraction.\n"
+      "      --no-cache recompiles the G-code instead of using the toolpath cache.\n"
+      "      --stream carves while the G-code is parsed (constant memory).\n"
+      "      --arc-tol is the max chord error of G2/G3 arcs (default 0.25 voxel).\n"
+      "      --units mm maps G-code millimetres onto the workpiece grid (default:\n"
+      "      voxel, coordinates are voxel offsets from the workpiece centre).\n"
+      "      --simplify drops toolpath points within that many voxels of the path\n"
+      "      before swept carving (default 0.25, 0 = off).\n"
+      "      --tools loads a tool library (e.g. 1=t1.bin,2=t2.bin): M6 switches the\n"
+      "      carving tool; other T numbers use --tool.\n"
+      "      --rapid/--accel set the machine limits of the printed cycle time.\n"
+      "      --resample brings tools to the workpiece voxel size (nearest, default;\n"
+      "      conservative; off), cached in .autocam_cache/tools.\n"
+      "      --plan prints the memory plan (workpiece, tools, stencil cache, readback,\n"
+      "      queued results) and stops; with --ram-mb / --vram-mb the run fails early\n"
+      "      when the plan does not fit, and the stencil cache / writer queue shrink.\n"
+      "      --hugetlb maps the large CPU buffers on explicit huge pages when reserved\n"
+      "      (transparent huge pages otherwise).\n\n"
       "  view <file.bin> [--ortho]\n"
       "      Raymarch-view a .bin voxel object.\n\n"
+      "  cycletime <f.gcode> [--rapid <mm/min>] [--accel <mm/s^2>] [--max-feed <mm/min>]\n"
+      "            [--arc-tol <mm>] [--no-cache]\n"
+      "      Print the analytic machining time of a G-code program (no carving).\n\n"
       "  help, --help\n"
       "      Show this message.\n";
 }
@@ -44,7 +82,7 @@ void printUsage() {
 int main(int argc, char** argv) {
   // Valueless flags: tokens the parser must NOT treat as "--key <value>".
   const std::unordered_set<std::string> valuelessFlags = {
-      "--ortho", "--perspective", "--no-view", "--verbose", "--legacy", "--help"};
+      "--ortho", "--perspective", "--no-view", "--verbose", "--legacy", "--no-cache", "--stream", "--plan", "--hugetlb", "--help"};
 
   try {
     CliArgs args = parseCli(argc, argv, valuelessFlags);
@@ -57,8 +95,12 @@ int main(int argc, char** argv) {
 
     // Dispatch to the selected sub-command.
     if (args.command == "voxelize") return runVoxelize(args);
+    if (args.command == "voxelize-batch") return runVoxelizeBatch(args);
+    if (args.command == "generate") return runGenerate(args);
+    if (args.command == "resample") return runResample(args);
     if (args.command == "simulate") return runSimulate(args);
     if (args.command == "view") return runView(args);
+    if (args.command == "cycletime") return runCycleTime(args);
 
     std::cerr << "Unknown command: '" << args.command << "'\n\n";
     printUsage();
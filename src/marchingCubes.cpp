@@ -178,14 +178,14 @@ void MarchingCubes::go() {
   int resX = p.resolutionXYZ.x;
   int resY = p.resolutionXYZ.y;
   int resZ = p.resolutionXYZ.z;
-  float s = p.resolution;
+  const glm::vec3 s = voxelSize(p);  // Z is finer on Z subdivided objects
 
   // Precompute some constants
   int resXp2 = resX + 2;
   int resYp2 = resY + 2;
   int resZp2 = resZ + 2;
 
-  auto pos = [&](int x, int y, int z) -> glm::vec3 { return p.center + glm::vec3(x * s, y * s, z * s); };
+  auto pos = [&](int x, int y, int z) -> glm::vec3 { return p.center + glm::vec3(x, y, z) * s; };
 
   // Roughly reserve space for the output buffers to avoid reallocations
   verticesFlat.reserve(1e6);  //@@@ Use heuristic based on resolution
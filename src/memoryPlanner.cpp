@@ -0,0 +1,193 @@
+#include "memoryPlanner.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+
+#include "boolOps.hpp"
+#include "voxelizerUtils.hpp"
+
+#define EST_TRANSITIONS_PER_COLUMN 2  // closed surfaces: one solid run per column
+#define CARVE_GROWTH 2                // a carved result holds at most ~2x the stock transitions (pocket floors, holes)
+#define RASTER_TRI_BYTES 104          // voxelizerCPU.cpp RasterTri: 3 dvec3 + area + 4 ints + flag
+#define CROSSING_BYTES 12             // voxelizerCPU.cpp Crossing: x, z, down
+#define TOOLPATH_MOVE_BYTES 25        // CompiledToolpath: x, y, z, feed, tool, line (4 bytes each) + move type
+#define GCODE_BYTES_PER_MOVE 24       // G-code source bytes per compiled move (one move per line)
+#define MAX_WRITER_QUEUE 4
+
+namespace {
+
+constexpr size_t U32 = sizeof(uint32_t);
+
+double toMB(size_t bytes) { return bytes / (1024.0 * 1024.0); }
+
+bool fitsBudget(size_t bytes, size_t budget) { return budget == 0 || bytes <= budget; }
+
+}  // namespace
+
+void MemoryPlan::add(const std::string& stage, MemoryPool pool, size_t bytes, const std::string& phase, bool estimate) {
+  items.push_back(MemoryItem{stage, pool, bytes, phase, estimate});
+}
+
+void MemoryPlan::finish(const MemoryBudget& budget) {
+  auto peakOf = [&](MemoryPool pool) {
+    size_t resident = 0;
+    std::vector<std::pair<std::string, size_t>> phases;
+    for (const MemoryItem& it : items) {
+      if (it.pool != pool) continue;
+      if (it.phase.empty()) {
+        resident += it.bytes;
+        continue;
+      }
+      auto p = std::find_if(phases.begin(), phases.end(), [&](const auto& e) { return e.first == it.phase; });
+      if (p == phases.end())
+        phases.emplace_back(it.phase, it.bytes);
+      else
+        p->second += it.bytes;
+    }
+    size_t worst = 0;
+    for (const auto& p : phases) worst = std::max(worst, p.second);
+    return resident + worst;
+  };
+  peakRam = peakOf(MemoryPool::RAM);
+  peakVram = peakOf(MemoryPool::VRAM);
+  fitsRam = fitsBudget(peakRam, budget.ramBytes);
+  fitsVram = fitsBudget(peakVram, budget.vramBytes);
+}
+
+size_t estimateToolpathMoves(size_t gcodeBytes) { return gcodeBytes / GCODE_BYTES_PER_MOVE; }
+
+MemoryPlan planVoxelization(const VoxelizationParams& params, VoxelizerBackend backend, size_t vertexCount, size_t triangleCount, int maxTilePx,
+                            const MemoryBudget& budget) {
+  const size_t columns = size_t(params.resolutionXYZ.x) * size_t(params.resolutionXYZ.y);
+  const size_t meshBytes = vertexCount * 3 * sizeof(float) + triangleCount * 3 * sizeof(unsigned int);
+  const size_t outTransitions = columns * EST_TRANSITIONS_PER_COLUMN;
+
+  auto build = [&](MemoryPlan& plan) {
+    plan.items.clear();
+    plan.add("mesh (vertices + indices)", MemoryPool::RAM, meshBytes);
+    plan.add("result prefixSumData", MemoryPool::RAM, columns * U32);
+    plan.add("result compressedData", MemoryPool::RAM, outTransitions * U32, "", true);
+    if (backend == VoxelizerBackend::CPU) {
+      // Rows of the grid are split across the workers: pixel-space triangles, row
+      // bins, per-row transitions, and every worker's crossings of one row.
+      const double rowsPerTri = std::max(1.0, params.resolutionXYZ.y / std::sqrt(std::max<double>(1.0, (double)triangleCount)));
+      plan.add("triangles in pixel space", MemoryPool::RAM, triangleCount * RASTER_TRI_BYTES, "raster");
+      plan.add("row bins", MemoryPool::RAM, size_t(triangleCount * rowsPerTri) * U32 + (params.resolutionXYZ.y + 1) * U32, "raster", true);
+      plan.add("per-row transitions", MemoryPool::RAM, outTransitions * U32, "raster", true);
+      plan.add("worker scratch (x" + std::to_string(plan.workers) + ")", MemoryPool::RAM,
+               plan.workers * size_t(params.resolutionXYZ.x) * EST_TRANSITIONS_PER_COLUMN * CROSSING_BYTES, "raster", true);
+      return;
+    }
+    VoxelizationParams tileParams = params;
+    tileParams.resolutionXYZ.x = plan.tile.x;
+    tileParams.resolutionXYZ.y = plan.tile.y;
+    tileParams.slicesPerBlock = plan.slicesPerBlock;
+    const size_t tileColumns = size_t(plan.tile.x) * size_t(plan.tile.y);
+    plan.add("mesh buffers (VBO + EBO)", MemoryPool::VRAM, meshBytes);
+    plan.add("slices + transition + output buffers (one tile)", MemoryPool::VRAM, estimateMemoryUsageBytes(tileParams, backend), "tile",
+             backend == VoxelizerBackend::GPU_TWO_PASS);
+    plan.add("tile readback (counts + prefix + transitions)", MemoryPool::RAM, tileColumns * (2 + EST_TRANSITIONS_PER_COLUMN) * U32, "tile", true);
+    if (tileColumns < columns)
+      plan.add("tile results before stitching", MemoryPool::RAM, (columns + outTransitions) * U32, "stitch", true);
+  };
+
+  MemoryPlan plan;
+  plan.workers = std::max(1u, budget.maxWorkers);
+  if (backend == VoxelizerBackend::CPU) {
+    // Fewest workers drop first: every worker holds the crossings of the row it is on.
+    for (;;) {
+      build(plan);
+      plan.finish(budget);
+      if (plan.fitsRam || plan.workers == 1) break;
+      --plan.workers;
+    }
+    return plan;
+  }
+
+  // Same choices the voxelizer makes (chooseTileSize / slices per block), under the VRAM budget.
+  VoxelizationParams sized = params;
+  if (budget.vramBytes) sized.maxMemoryBudgetBytes = budget.vramBytes;
+  plan.tile = chooseTileSize(sized, backend, maxTilePx);
+  VoxelizationParams tileParams = sized;
+  tileParams.resolutionXYZ.x = plan.tile.x;
+  tileParams.resolutionXYZ.y = plan.tile.y;
+  plan.slicesPerBlock = chooseOptimalPowerOfTwoSlicesPerBlock(tileParams, backend);
+  build(plan);
+  plan.finish(budget);
+  return plan;
+}
+
+MemoryPlan planSimulation(const SimulationShape& shape, const MemoryBudget& budget) {
+  const size_t columns = size_t(shape.stock.resolutionXYZ.x) * size_t(shape.stock.resolutionXYZ.y);
+  const size_t flatBytes = columns * BoolOps::flatTransitionsPerColumn() * U32;
+  const size_t resultTransitions = std::min(shape.stockTransitions * CARVE_GROWTH, columns * BoolOps::flatTransitionsPerColumn());
+  const size_t resultBytes = (resultTransitions + columns) * U32;
+
+  auto build = [&](MemoryPlan& plan) {
+    plan.items.clear();
+    plan.add("workpiece (compressed)", MemoryPool::RAM, (shape.stockTransitions + columns) * U32);
+    plan.add("workpiece unpacked (kept for reset)", MemoryPool::RAM, flatBytes + columns * U32);
+    plan.add("workpiece flat buffer + counts", MemoryPool::VRAM, flatBytes + columns * U32);
+    for (size_t i = 0; i < shape.tools.size(); ++i) {
+      const VoxelizationParams& tp = shape.tools[i].first;
+      const size_t toolColumns = size_t(tp.resolutionXYZ.x) * size_t(tp.resolutionXYZ.y);
+      const size_t toolBytes = (shape.tools[i].second + toolColumns) * U32;
+      const std::string name = "tool " + std::to_string(i + 1);
+      // Swept envelope (prepareSweptTool): one (lo, hi) pair per column for convex tools, plus the column starts.
+      plan.add(name + " + swept intervals", MemoryPool::RAM, toolBytes + toolColumns * 3 * U32 + U32, "", true);
+      plan.add(name + " buffers", MemoryPool::VRAM, toolBytes);
+    }
+    if (shape.toolpathMoves) plan.add("compiled + simplified toolpath", MemoryPool::RAM, 2 * shape.toolpathMoves * TOOLPATH_MOVE_BYTES, "", true);
+    plan.add("swept-stencil cache", MemoryPool::VRAM, plan.stencilCacheBytes);
+
+    // copyBack(): counts and prefix sum on the CPU, compaction on the GPU, compact readback.
+    plan.add("readback counts + prefix", MemoryPool::RAM, 2 * columns * U32, "readback");
+    plan.add("carved result", MemoryPool::RAM, resultBytes, "readback", true);
+    plan.add("compaction buffers", MemoryPool::VRAM, resultBytes, "readback", true);
+    if (shape.saveOut) plan.add("results queued for writing (x" + std::to_string(plan.writerQueue) + ")", MemoryPool::RAM, plan.writerQueue * resultBytes, "", true);
+    if (shape.viewer) plan.add("viewer copy of the result", MemoryPool::VRAM, resultBytes, "view", true);
+  };
+
+  MemoryPlan plan;
+  plan.workers = std::max(1u, budget.maxWorkers);
+  plan.writerQueue = shape.saveOut && budget.ramBytes ? MAX_WRITER_QUEUE : 2;  // ResultWriter's default without a RAM budget
+  plan.stencilCacheBytes = BoolOps::defaultStencilCacheBytes();
+
+  // The writer queue only trades throughput for RAM: shrink it until the plan fits.
+  for (;;) {
+    build(plan);
+    plan.finish(budget);
+    if (plan.fitsRam || !shape.saveOut || plan.writerQueue == 1) break;
+    --plan.writerQueue;
+  }
+
+  // The stencil cache gets whatever VRAM is left, up to its built-in size.
+  if (budget.vramBytes && !plan.fitsVram) {
+    const size_t without = plan.peakVram - plan.stencilCacheBytes;
+    plan.stencilCacheBytes = budget.vramBytes > without ? budget.vramBytes - without : 0;
+    build(plan);
+    plan.finish(budget);
+  }
+  return plan;
+}
+
+void printMemoryPlan(const MemoryPlan& plan, const MemoryBudget& budget, std::ostream& os) {
+  const std::ios::fmtflags flags = os.flags();
+  os << std::fixed << std::setprecision(1);
+  for (const MemoryItem& it : plan.items) {
+    os << "  " << (it.pool == MemoryPool::RAM ? "RAM " : "VRAM") << " " << std::setw(10) << toMB(it.bytes) << " MB  " << it.stage;
+    if (!it.phase.empty()) os << " [" << it.phase << "]";
+    if (it.estimate) os << " (est.)";
+    os << "\n";
+  }
+  auto line = [&](const char* pool, size_t peak, size_t limit, bool fits) {
+    os << "  Peak " << pool << ": " << toMB(peak) << " MB";
+    if (limit) os << " / budget " << toMB(limit) << " MB" << (fits ? "" : "  ** OVER BUDGET **");
+    os << "\n";
+  };
+  line("RAM ", plan.peakRam, budget.ramBytes, plan.fitsRam);
+  line("VRAM", plan.peakVram, budget.vramBytes, plan.fitsVram);
+  os.flags(flags);
+}
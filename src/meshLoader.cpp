@@ -9,32 +9,48 @@
 #include <cfloat>
 #include <algorithm>
 #include "meshTypes.hpp"
+#include "stlLoader.hpp"
 #include <glm/glm.hpp>
 
 Mesh loadMesh(const char* path) {
+  // STL (the voxelizer's input format) goes through the native reader: no Assimp
+  // import overhead, and the vertices come back welded.
+  if (isStlFile(path)) {
+    try {
+      return loadStl(path);
+    } catch (const std::exception& e) {
+      std::cerr << "Native STL reader failed (" << e.what() << "), falling back to Assimp." << std::endl;
+    }
+  }
+
   Assimp::Importer importer;
-  const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenNormals);
+  const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate);
   if (!scene || !scene->HasMeshes()) throw std::runtime_error("Failed to load mesh");
 
-  aiMesh* mesh = scene->mMeshes[0];
-
-  // Extract vertices and indices from the mesh
+  // Merge every mesh of the scene into one vertex/index array (not just mMeshes[0]).
   std::vector<float> vertices;
-  vertices.reserve(mesh->mNumVertices * 3);
-  for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+  std::vector<unsigned int> indices;
+  for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+    aiMesh* mesh = scene->mMeshes[m];
+    const unsigned int base = (unsigned int)(vertices.size() / 3);
+
+    vertices.reserve(vertices.size() + mesh->mNumVertices * 3);
+    for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
       aiVector3D& vertex = mesh->mVertices[i];
 
       vertices.push_back(vertex.x);
       vertices.push_back(vertex.y);
       vertices.push_back(vertex.z);
-  }
+    }
 
-  std::vector<unsigned int> indices;
-  for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
+    indices.reserve(indices.size() + mesh->mNumFaces * 3);
+    for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
       aiFace& face = mesh->mFaces[i];
-      indices.push_back(face.mIndices[0]);
-      indices.push_back(face.mIndices[1]);
-      indices.push_back(face.mIndices[2]);
+      if (face.mNumIndices != 3) continue;  // points/lines left over by triangulation
+      indices.push_back(base + face.mIndices[0]);
+      indices.push_back(base + face.mIndices[1]);
+      indices.push_back(base + face.mIndices[2]);
+    }
   }
 
   Mesh result;
@@ -0,0 +1,67 @@
+// =============================================================================
+//  cycletime_mode.cpp - `cycletime` sub-command.
+//
+//  Compiles a G-code program (through the toolpath cache) and prints its
+//  analytic machining time: feed-limited per segment, rapids at --rapid, and
+//  trapezoidal speed profiles when --accel is given. No GPU, no wall clock.
+//
+//  Usage:
+//    voxelize cycletime <f.gcode> [--rapid <mm/min>] [--accel <mm/s^2>] [--max-feed <mm/min>]
+//                       [--arc-tol <mm>] [--no-cache]
+// =============================================================================
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "cli.hpp"
+#include "cycleTime.hpp"
+#include "main_params.hpp"
+#include "modes.hpp"
+#include "toolpath.hpp"
+
+// 3725.5 -> "1:02:05.5"
+static std::string formatDuration(double seconds) {
+  const long whole = (long)seconds;
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "%ld:%02ld:%04.1f", whole / 3600, (whole / 60) % 60, seconds - (double)(whole - whole % 60));
+  return buf;
+}
+
+int runCycleTime(const CliArgs& args) {
+  if (args.positionals.empty()) {
+    std::cerr << "cycletime: missing input G-code path.\n";
+    printUsage();
+    return EXIT_FAILURE;
+  }
+  const std::string gcodePath = args.positionals[0];
+  ToolpathOptions opts;
+  opts.arcTolerance = args.getFloat("--arc-tol", ARC_TOLERANCE);  // mm: the compiled toolpath is in machine mm
+  if (!(opts.arcTolerance > 0.0f)) {
+    std::cerr << "--arc-tol must be > 0 (got " << opts.arcTolerance << ")\n";
+    return EXIT_FAILURE;
+  }
+  MachineLimits limits;
+  limits.rapidRate = args.getFloat("--rapid", (float)RAPID_RATE);
+  limits.acceleration = args.getFloat("--accel", (float)MACHINE_ACCEL);
+  limits.maxFeed = args.getFloat("--max-feed", 0.0f);
+
+  CompiledToolpath toolpath;
+  bool fromCache = false;
+  if (!compileToolpath(gcodePath, toolpath, opts, args.has("--no-cache") ? "" : TOOLPATH_CACHE_DIR, nullptr, &fromCache)) {
+    std::cerr << "Failed to load G-code file: " << gcodePath << "\n";
+    return EXIT_FAILURE;
+  }
+
+  auto t0 = std::chrono::high_resolution_clock::now();
+  const CycleTimeReport r = estimateCycleTime(toolpath, limits);
+  const double us = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - t0).count();
+
+  std::cout << "Tempo ciclo: " << formatDuration(r.seconds) << " (" << r.seconds << " s)\n"
+            << "  lavoro: " << formatDuration(r.cutSeconds) << ", " << r.cutLength << " mm\n"
+            << "  rapidi: " << formatDuration(r.rapidSeconds) << ", " << r.rapidLength << " mm\n"
+            << r.segments << " segmenti" << (fromCache ? " (toolpath da cache)" : "") << " | calcolato in " << us << " us\n";
+  if (r.zeroFeed) std::cerr << "Attenzione: " << r.zeroFeed << " segmenti di lavoro senza feed (F) non conteggiati\n";
+  return EXIT_SUCCESS;
+}
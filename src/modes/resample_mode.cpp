@@ -0,0 +1,87 @@
+// =============================================================================
+//  resample_mode.cpp - `resample` sub-command.
+//
+//  Converts a .bin voxel object to another voxel size by resampling its
+//  columns (voxelResample.hpp), instead of re-voxelizing the mesh. No GPU.
+//  The target must be one the params can store: square in XY, and a Z that is
+//  the XY size or XY / n (--voxel x,x,x/n is the same as --res x --zsub n).
+//
+//  Usage:
+//    voxelize resample <in.bin> --res <float> [--zsub <n>] | --voxel <x,y,z> [--mode nearest|conservative] [--out <file.bin>]
+// =============================================================================
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <string>
+
+#include "boolOps.hpp"
+#include "cli.hpp"
+#include "main_params.hpp"
+#include "modes.hpp"
+#include "resultWriter.hpp"
+#include "voxelResample.hpp"
+
+int runResample(const CliArgs& args) {
+  if (args.positionals.empty() || (!args.has("--res") && !args.has("--voxel"))) {
+    std::cerr << "resample: missing input .bin or target voxel size (--res / --voxel).\n";
+    printUsage();
+    return EXIT_FAILURE;
+  }
+  const std::string input = args.positionals[0];
+  glm::vec3 voxelSize(args.getFloat("--res", 0.0f));
+  const int zSub = args.getInt("--zsub", 1);
+  if (zSub < 1) {
+    std::cerr << "--zsub must be >= 1 (got " << zSub << ")\n";
+    return EXIT_FAILURE;
+  }
+  voxelSize.z /= zSub;  // fixed-point Z: n slices per XY voxel
+  if (args.has("--voxel") && std::sscanf(args.get("--voxel", "").c_str(), "%f,%f,%f", &voxelSize.x, &voxelSize.y, &voxelSize.z) != 3) {
+    std::cerr << "Invalid --voxel value: " << args.get("--voxel", "") << " (expected x,y,z)\n";
+    return EXIT_FAILURE;
+  }
+  if (voxelSize.x <= 0.0f || voxelSize.y <= 0.0f || voxelSize.z <= 0.0f) {
+    std::cerr << "Invalid target voxel size\n";
+    return EXIT_FAILURE;
+  }
+  // A .bin stores one XY size (`resolution`) and the Z subdivision n: reject what
+  // would read back with another voxel size.
+  const long n = std::lround(voxelSize.x / voxelSize.z);
+  if (std::abs(voxelSize.y - voxelSize.x) > 1e-4f * voxelSize.x || n < 1 || std::abs(voxelSize.x / n - voxelSize.z) > 1e-4f * voxelSize.z) {
+    std::cerr << "Unsupported --voxel " << voxelSize.x << "," << voxelSize.y << "," << voxelSize.z
+              << ": X and Y must be equal and Z must be X / n (n >= 1)\n";
+    return EXIT_FAILURE;
+  }
+  voxelSize = glm::vec3(voxelSize.x, voxelSize.x, voxelSize.x / n);
+  ResampleMode mode;
+  if (!parseResampleMode(args.get("--mode", "nearest"), mode)) {
+    std::cerr << "Unknown --mode value: " << args.get("--mode", "") << " (expected nearest or conservative)\n";
+    return EXIT_FAILURE;
+  }
+  std::string out = args.get("--out", "");
+  if (out.empty()) {
+    const size_t dot = input.rfind(".bin");
+    out = (dot == std::string::npos ? input : input.substr(0, dot)) + "_resampled.bin";
+  }
+
+  VoxelObject source, result;
+  if (!BoolOps::loadObject(input, source)) {
+    std::cerr << "Failed to load voxel object: " << input << "\n";
+    return EXIT_FAILURE;
+  }
+  auto t0 = std::chrono::high_resolution_clock::now();
+  resampleVoxelObject(source, voxelSize, mode, result);
+  const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+  const glm::ivec3 a = source.params.resolutionXYZ, b = result.params.resolutionXYZ;
+  std::cout << "Resampled " << a.x << " x " << a.y << " x " << a.z << " -> " << b.x << " x " << b.y << " x " << b.z << " voxels in " << ms << " ms\n";
+
+  if (!writeVoxelObject(result, out)) {
+    std::cerr << "Failed to write " << out << "\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << "Saved: " << out << "\n";
+  return EXIT_SUCCESS;
+}
@@ -8,113 +8,400 @@
 //
 //  Usage:
 //    voxelize simulate --gcode <f.gcode> --workpiece <w.bin> --tool <t.bin>
-//                      [--out <r.bin>] [--step <float>] [--perspective] [--no-view]
+//                      [--out <r.bin>] [--runs <n>] [--step <float>] [--perspective] [--no-view]
+//                      [--stream] [--arc-tol <float>] [--units mm|voxel] [--simplify <float>]
+//                      [--tools <T=t.bin,...>] [--rapid <mm/min>] [--accel <mm/s^2>]
+//                      [--ram-mb <int>] [--vram-mb <int>] [--plan] [--hugetlb]
 // =============================================================================
 
 #include <glm/glm.hpp>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "GLUtils.hpp"
 #include "cli.hpp"
+#include "cycleTime.hpp"
 #include "gcode.hpp"
 #include "gcodeViewer.hpp"  // GcodeViewer, ProjectionType (also pulls in VoxelObject)
+#include "hugePageBuffer.hpp"
 #include "main_params.hpp"
+#include "memoryPlanner.hpp"
 #include "modes.hpp"
+#include "resultWriter.hpp"
+#include "toolpathCursor.hpp"
+#include "toolpathStream.hpp"
 #include "voxelViewer.hpp"
 
+// "<dir>/name.bin" -> "<dir>/name_<run>.bin" (one output file per run with --runs N).
+static std::string runOutputPath(const std::string& path, int run) {
+  const size_t slash = path.find_last_of("/\\");
+  const size_t dot = path.find_last_of('.');
+  const bool hasExt = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+  const std::string stem = hasExt ? path.substr(0, dot) : path;
+  return stem + "_" + std::to_string(run) + (hasExt ? path.substr(dot) : "");
+}
+
+// "1=a.bin,2=b.bin" -> {(1, "a.bin"), (2, "b.bin")}. False on a malformed entry.
+static bool parseToolList(const std::string& spec, std::vector<std::pair<int, std::string>>& tools) {
+  size_t begin = 0;
+  while (begin < spec.size()) {
+    size_t end = spec.find(',', begin);
+    if (end == std::string::npos) end = spec.size();
+    const std::string entry = spec.substr(begin, end - begin);
+    const size_t eq = entry.find('=');
+    if (eq == 0 || eq == std::string::npos || eq + 1 == entry.size()) return false;
+    try {
+      size_t used = 0;
+      const int number = std::stoi(entry.substr(0, eq), &used);
+      if (used != eq) return false;
+      tools.emplace_back(number, entry.substr(eq + 1));
+    } catch (const std::exception&) {
+      return false;
+    }
+    begin = end + 1;
+  }
+  return true;
+}
+
 int runSimulate(const CliArgs& args) {
   // Resolve inputs from CLI, falling back to the defaults in main_params.hpp.
   const std::string gcodePath = args.get("--gcode", GCODE_PATH);
   const std::string workpiecePath = args.get("--workpiece", DEFAULT_WORKPIECE_BIN);
   const std::string toolPath = args.get("--tool", DEFAULT_TOOL_BIN);
   const float step = args.getFloat("--step", 2.0f);
+  if (!(step > 0.0f)) {
+    std::cerr << "--step must be > 0 (got " << step << ")\n";
+    return EXIT_FAILURE;
+  }
+  // G2/G3 are tessellated into chords deviating at most --arc-tol voxels from the arc.
+  const float arcTolVoxels = args.getFloat("--arc-tol", ARC_TOLERANCE);
+  if (!(arcTolVoxels > 0.0f)) {
+    std::cerr << "--arc-tol must be > 0 (got " << arcTolVoxels << ")\n";
+    return EXIT_FAILURE;
+  }
+  // Swept carving drops toolpath points while staying within --simplify voxels of the path (0 = off).
+  const float simplifyTol = std::max(0.0f, args.getFloat("--simplify", SIMPLIFY_TOLERANCE));
+  ToolpathOptions toolpathOptions;
+  toolpathOptions.arcTolerance = arcTolVoxels;
+
+  // Program units. "voxel" keeps the historical convention (coordinates are voxel
+  // offsets from the workpiece centre, +Z up). "mm" maps the compiled machine
+  // millimetres onto the workpiece grid with one affine transform built from the
+  // stock's params, applied once to the whole toolpath before carving.
+  const std::string units = args.get("--units", DEFAULT_UNITS);
+  // Tools are brought to the stock's voxel size (resampled once per size, cached);
+  // "off" uses them at their own voxel size.
+  const std::string resampleName = args.get("--resample", DEFAULT_RESAMPLE);
+  const bool resampleTools = resampleName != "off";
+  ResampleMode resampleMode = ResampleMode::NEAREST;
+  if (resampleTools && !parseResampleMode(resampleName, resampleMode)) {
+    std::cerr << "Unknown --resample value: " << resampleName << " (expected nearest, conservative or off)\n";
+    return EXIT_FAILURE;
+  }
+  ToolpathTransform toVoxels;
+  if (units == "mm") {
+    VoxelizationParams stockParams, toolParams;
+    if (!BoolOps::loadParams(workpiecePath, stockParams) || !BoolOps::loadParams(toolPath, toolParams)) {
+      std::cerr << "Failed to read workpiece/tool params: " << workpiecePath << ", " << toolPath << "\n";
+      return EXIT_FAILURE;
+    }
+    const float res = stockParams.resolution;         // mm per voxel (XY)
+    const glm::vec3 voxel = voxelSize(stockParams);  // Z finer with --zsub stocks
+    if (!resampleTools && (std::abs(toolParams.resolution - res) > 1e-4f * res || zSubdivision(toolParams) != zSubdivision(stockParams)))
+      std::cerr << "Attenzione: risoluzione utensile (" << toolParams.resolution << ") diversa dal workpiece (" << res << ")\n";
+    toolpathOptions.arcTolerance = arcTolVoxels * res;
+    toVoxels.scale = 1.0f / voxel;
+    // Tool tips sit at the programmed Z: the viewer lifts each tool by half its own
+    // height when it carves (setToolTipAtZ), not the whole toolpath by the default tool's.
+    toVoxels.offset = -stockParams.center / voxel;
+  } else if (units == "voxel") {
+    // Voxel-unit programs count XY voxels on every axis: a Z subdivided stock takes n slices per unit of Z.
+    VoxelizationParams stockParams;
+    if (BoolOps::loadParams(workpiecePath, stockParams) && zSubdivision(stockParams) > 1) toVoxels.scale.z = (float)zSubdivision(stockParams);
+  } else {
+    std::cerr << "Unknown --units value: " << units << " (expected mm or voxel)\n";
+    return EXIT_FAILURE;
+  }
+  // Resident tool library: T numbers -> tool .bin files, loaded once. M6 in the program
+  // then switches the carving tool per segment; --tool carves any other T number.
+  std::vector<std::pair<int, std::string>> toolLibrary;
+  if (!parseToolList(args.get("--tools", ""), toolLibrary)) {
+    std::cerr << "Invalid --tools value: " << args.get("--tools", "") << " (expected T=file.bin,...)\n";
+    return EXIT_FAILURE;
+  }
+  const bool multiTool = !toolLibrary.empty();
   const bool showViewer = !args.has("--no-view");
   const bool legacy = args.has("--legacy");  // per-step stamping (Phase 1) instead of swept (Phase 2)
+  // Carve while the program is being parsed (swept carving only: legacy stepping needs the whole toolpath).
+  const bool streaming = args.has("--stream") && !legacy;
+  if (args.has("--stream") && legacy) std::cerr << "--stream ignorato con --legacy\n";
   // The simulation defaults to an orthographic (top-down CNC) view; --perspective switches it.
   const ProjectionType projection =
       args.has("--perspective") ? ProjectionType::PERSPECTIVE : ProjectionType::ORTHOGRAPHIC;
 
+  // Memory plan (memoryPlanner.hpp): workpiece, tools, stencil cache, readback and
+  // queued results sized from the .bin headers against --ram-mb / --vram-mb, before
+  // anything is allocated. It picks the stencil cache size and the writer queue depth.
+  MemoryBudget budget;
+  budget.ramBytes = static_cast<size_t>(args.getInt("--ram-mb", 0)) * 1024 * 1024;
+  budget.vramBytes = static_cast<size_t>(args.getInt("--vram-mb", 0)) * 1024 * 1024;
+  SimulationShape shape;
+  if (!BoolOps::loadParams(workpiecePath, shape.stock, &shape.stockTransitions)) {
+    std::cerr << "Failed to read workpiece: " << workpiecePath << "\n";
+    return EXIT_FAILURE;
+  }
+  std::vector<std::string> toolFiles{toolPath};
+  for (const auto& t : toolLibrary) toolFiles.push_back(t.second);
+  for (const std::string& file : toolFiles) {
+    VoxelizationParams tp;
+    size_t transitions = 0;
+    if (!BoolOps::loadParams(file, tp, &transitions)) continue;  // reported when the tool is loaded
+    if (resampleTools) {
+      // Resampled to the stock voxel size: about as many transitions per column as before.
+      const double columns = double(tp.resolutionXYZ.x) * tp.resolutionXYZ.y;
+      tp.resolutionXYZ = resampledResolution(tp, voxelSize(shape.stock));
+      transitions = size_t(transitions * (double(tp.resolutionXYZ.x) * tp.resolutionXYZ.y / std::max(1.0, columns)));
+    }
+    shape.tools.emplace_back(tp, transitions);
+  }
+  std::error_code sizeError;
+  const size_t gcodeBytes = std::filesystem::file_size(gcodePath, sizeError);
+  if (!streaming && !sizeError) shape.toolpathMoves = estimateToolpathMoves(gcodeBytes);
+  shape.saveOut = args.has("--out");
+  shape.viewer = showViewer;
+  const MemoryPlan plan = planSimulation(shape, budget);
+  if (args.has("--plan")) {
+    std::cout << "Piano di memoria (grezzo " << shape.stock.resolutionXYZ.x << " x " << shape.stock.resolutionXYZ.y << " x "
+              << shape.stock.resolutionXYZ.z << " voxel, " << shape.tools.size() << " utensili):\n";
+    printMemoryPlan(plan, budget, std::cout);
+    return plan.fits() ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  std::cout << "Piano di memoria: picco RAM " << plan.peakRam / (1024.0 * 1024.0) << " MB, VRAM " << plan.peakVram / (1024.0 * 1024.0)
+            << " MB | cache stencil " << plan.stencilCacheBytes / (1024.0 * 1024.0) << " MB, coda scrittura " << plan.writerQueue << "\n";
+  if (!plan.fits()) {
+    std::cerr << "La simulazione non rientra nel budget di memoria (--ram-mb / --vram-mb): vedi --plan\n";
+    return EXIT_FAILURE;
+  }
+
+  // Large CPU buffers (flat workpiece, stencil envelopes) try explicit huge pages first
+  // (hugePageBuffer.hpp); transparent huge pages are used either way.
+  if (args.has("--hugetlb")) useExplicitHugePages(true);
+
   // A visible OpenGL context/window is required for the carving pipeline.
   GLFWwindow* window = nullptr;
   setupGLContext(&window, 800, 600, "autocam - simulate", false);
 
-  // Load and validate the G-code toolpath.
+  // Load and validate the G-code toolpath (in streaming mode it is parsed during carving).
   GCodeInterpreter interpreter;
   interpreter.setVerbose(args.has("--verbose"));  // off by default; --verbose dumps each command
-  if (!interpreter.loadFile(gcodePath)) {
-    std::cerr << "Failed to load G-code file: " << gcodePath << "\n";
-    destroyGLContext(window);
-    return EXIT_FAILURE;
+  if (streaming) {
+    if (!std::ifstream(gcodePath)) {
+      std::cerr << "Failed to load G-code file: " << gcodePath << "\n";
+      destroyGLContext(window);
+      return EXIT_FAILURE;
+    }
+  } else {
+    // The compiled toolpath is cached by content hash; --no-cache always recompiles.
+    const std::string cacheDir = args.has("--no-cache") ? "" : TOOLPATH_CACHE_DIR;
+    if (!interpreter.loadFile(gcodePath, toolpathOptions, cacheDir)) {
+      std::cerr << "Failed to load G-code file: " << gcodePath << "\n";
+      destroyGLContext(window);
+      return EXIT_FAILURE;
+    }
+    const GcodeParseStats& ps = interpreter.getParseStats();
+    if (interpreter.loadedFromCache()) {
+      std::cout << "G-code: " << interpreter.getToolpath().size() << " movimenti | toolpath compilato da cache (" << ps.ms << " ms)\n";
+    } else {
+      std::cout << "G-code: " << ps.lines << " righe, " << ps.moves << " movimenti (" << ps.arcs << " archi) | parsing " << ps.ms
+                << " ms (" << (ps.ms > 0.0 ? ps.bytes / (ps.ms * 1e3) : 0.0) << " MB/s, " << ps.chunks << " chunk)\n";
+    }
+    if (!interpreter.checkFile()) {
+      std::cerr << "Invalid G-code file: " << gcodePath << "\n";
+      destroyGLContext(window);
+      return EXIT_FAILURE;
+    }
+
+    // Analytic machining time (cycleTime.hpp), on the compiled path before it is
+    // mapped to voxels; voxel-unit programs are scaled by the stock resolution.
+    MachineLimits limits;
+    limits.rapidRate = args.getFloat("--rapid", (float)RAPID_RATE);
+    limits.acceleration = args.getFloat("--accel", (float)MACHINE_ACCEL);
+    VoxelizationParams stockParams;
+    if (units == "voxel" && BoolOps::loadParams(workpiecePath, stockParams)) limits.lengthScale = stockParams.resolution;
+    const CycleTimeReport ct = estimateCycleTime(interpreter.getToolpath(), limits);
+    std::cout << "Tempo ciclo stimato: " << ct.seconds << " s (lavoro " << ct.cutSeconds << " s, rapidi " << ct.rapidSeconds << " s)\n";
+
+    interpreter.applyTransform(toVoxels);  // from here on positions are workpiece voxel offsets
   }
-  if (!interpreter.checkFile()) {
-    std::cerr << "Invalid G-code file: " << gcodePath << "\n";
-    destroyGLContext(window);
-    return EXIT_FAILURE;
+
+  // Simplify once, in voxel space, for the swept carve (legacy stepping walks the
+  // interpreter's full toolpath).
+  CompiledToolpath simplifiedPath;
+  if (!streaming && !legacy) {
+    auto tSimplify = std::chrono::high_resolution_clock::now();
+    simplifyToolpath(interpreter.getToolpath(), simplifiedPath, simplifyTol);
+    const double simplifyMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tSimplify).count();
+    const size_t before = interpreter.getToolpath().size(), after = simplifiedPath.size();
+    std::cout << "Semplificazione (" << simplifyTol << " voxel): " << before << " -> " << after << " punti (riduzione "
+              << (before ? 100.0 * (before - after) / before : 0.0) << "%, " << simplifyMs << " ms)\n";
   }
 
   // Carve inside a scope so that GcodeViewer (which owns GL resources, including a
   // BoolOps member) is destroyed while the OpenGL context is still current — BEFORE
   // destroyGLContext()/glfwTerminate(). Otherwise its destructor's GL calls would
   // run with no live context and crash.
-  VoxelObject carved;
+  SharedVoxelObject carved;  // last carved result, shared by the viewer and the writer
+  bool failed = false;  // a tool didn't load, or the streamed G-code had no moves
   {
-    // Extract the toolpath once (getToolpath re-parses the program, so don't call it twice).
-    const std::vector<GcodePoint> toolpath = interpreter.getToolpath();
+    // The compiled toolpath (structure of arrays), shared by reference with the viewer.
+    // When streaming nothing holds the moves: the carving only sees the batches in
+    // flight and the result viewer (VoxelViewer) draws no toolpath.
+    const CompiledToolpath noPath;
+    const CompiledToolpath& toolpath = streaming ? noPath : legacy ? interpreter.getToolpath() : simplifiedPath;
 
     GcodeViewer gCodeViewer(window, toolpath);
     gCodeViewer.setProjectionType(projection);
+    gCodeViewer.setStencilCacheBytes(plan.stencilCacheBytes);
+    gCodeViewer.setToolTipAtZ(units == "mm");
     gCodeViewer.setWorkpiece(workpiecePath);
+    VoxelizationParams stockParams;
+    if (resampleTools && BoolOps::loadParams(workpiecePath, stockParams))
+      gCodeViewer.setToolVoxelSize(voxelSize(stockParams), resampleMode, args.has("--no-cache") ? "" : TOOL_CACHE_DIR);
     gCodeViewer.setTool(toolPath);
+    for (const auto& t : toolLibrary)
+      if (!gCodeViewer.addTool(t.first, t.second)) failed = true;  // reported by addTool; nothing is carved
+    std::set<int> missingTools;  // T numbers already reported as not in the library
+    auto selectTool = [&](int number) {
+      // T0 is the spindle before the first M6: the default tool unless --tools maps it.
+      if (!gCodeViewer.selectTool(number) && number != 0 && missingTools.insert(number).second)
+        std::cerr << "Utensile T" << number << " non presente in --tools: uso l'utensile di default\n";
+    };
+
+    // Results are saved by a background writer, so the next run starts as soon as
+    // the current result has been read back. Runs > 1 restart from the uncarved
+    // workpiece (throughput benchmark / dataset generation).
+    ResultWriter writer(plan.writerQueue);
+    const bool saveOut = args.has("--out");
+    const std::string outPath = args.get("--out", "");
+    const int runs = std::max(1, args.getInt("--runs", 1));
+
+    auto tRunsStart = std::chrono::high_resolution_clock::now();
+    for (int run = 0; run < runs && !failed; ++run) {
+      if (run > 0) gCodeViewer.resetWorkpiece();
 
-    auto tStart = std::chrono::high_resolution_clock::now();
-    long steps = 0;
-    if (legacy) {
-      // Phase 1: stamp the full tool at every fixed jog step.
-      interpreter.beginJog();
-      while (!interpreter.jogComplete()) {
-        interpreter.jog(step);  // advance by `step` voxel units (TODO: real mm units)
-        glm::vec3 pos = interpreter.getCurrentPosition();
-        gCodeViewer.carve(pos);
-        ++steps;
+      gCodeViewer.resetClipStats();
+      gCodeViewer.resetStencilStats();
+      gCodeViewer.resetToolChanges();
+      auto tStart = std::chrono::high_resolution_clock::now();
+      long steps = 0;
+      GcodeParseStats streamStats;
+      double firstBatchMs = 0.0;
+      size_t keptMoves = 0;
+      if (legacy) {
+        // Phase 1: stamp the full tool at every fixed step. The cursor fills one
+        // batch of positions at a time and the batch is stamped in one call.
+        ToolpathCursor cursor(toolpath);
+        std::vector<float> bx(STAMP_BATCH), by(STAMP_BATCH), bz(STAMP_BATCH);
+        while (size_t n = cursor.advance(step, bx.data(), by.data(), bz.data(), STAMP_BATCH)) {  // `step` voxel units (TODO: real mm units)
+          gCodeViewer.carveBatch(bx.data(), by.data(), bz.data(), n);
+          gCodeViewer.setToolPosition(cursor.snapshot().position);
+          steps += (long)n;
+        }
+      } else if (streaming) {
+        // Phase 2, streamed: a parser thread feeds batches of moves through an SPSC
+        // ring; segments are carved as soon as their batch arrives.
+        ToolpathStream stream(gcodePath, toolpathOptions, toVoxels, simplifyTol);
+        glm::vec3 prev(0.0f);
+        bool havePrev = false;
+        while (const CompiledToolpath* batch = stream.next()) {
+          for (size_t i = 0; i < batch->size(); ++i) {
+            const glm::vec3 p = batch->position(i);
+            if (multiTool) selectTool(batch->tool[i]);  // the segment ending at i runs with move i's tool
+            if (havePrev && gCodeViewer.carveSwept(prev, p)) ++steps;
+            prev = p;
+            havePrev = true;
+          }
+        }
+        streamStats = stream.stats();
+        firstBatchMs = stream.firstBatchMs();
+        keptMoves = stream.keptMoves();
+        if (streamStats.moves == 0) {
+          // Same as checkFile() on the non-streamed path: nothing to carve is an error.
+          std::cerr << "Invalid G-code file: " << gcodePath << " (nessun movimento)\n";
+          failed = true;
+          break;
+        }
+      } else {
+        // Phase 2: one swept subtraction per linear toolpath segment.
+        for (size_t i = 0; i + 1 < toolpath.size(); ++i) {
+          if (multiTool) selectTool(toolpath.tool[i + 1]);  // the segment ending at i + 1 runs with its tool
+          if (gCodeViewer.carveSwept(toolpath.position(i), toolpath.position(i + 1))) ++steps;
+        }
       }
-      interpreter.resetJog();
-    } else {
-      // Phase 2: one swept subtraction per linear toolpath segment.
-      for (size_t i = 0; i + 1 < toolpath.size(); ++i) {
-        gCodeViewer.carveSwept(toolpath[i].position, toolpath[i + 1].position);
-        ++steps;
+      // Wait for the GPU carving to actually complete, to measure the net carving time
+      // separately from copyBack. This sync is free: copyBack() syncs anyway, so the
+      // total is unchanged.
+      gCodeViewer.finishGPU();
+      auto tCarveDone = std::chrono::high_resolution_clock::now();
+
+      // Pull the carved workpiece back from the GPU to CPU memory (readback + GPU compaction).
+      gCodeViewer.copyBack();
+      auto tDone = std::chrono::high_resolution_clock::now();
+
+      const double carveMs = std::chrono::duration<double, std::milli>(tCarveDone - tStart).count();
+      const double totalMs = std::chrono::duration<double, std::milli>(tDone - tStart).count();
+      std::cout << "\n";  // terminate the in-place carving counter line
+      std::cout << "Carving [" << (legacy ? "legacy" : "swept") << "]: " << steps
+                << (legacy ? " passi" : " segmenti") << " | carving netto " << carveMs
+                << " ms | totale (incl. copyback) " << totalMs << " ms\n";
+      if (!legacy) {
+        const GcodeViewer::ClipStats& clip = gCodeViewer.getClipStats();
+        std::cout << "Clipping: " << clip.dropped << " segmenti fuori dal grezzo scartati, " << clip.clipped << " accorciati\n";
+        const BoolOps::StencilStats& st = gCodeViewer.getStencilStats();
+        if (multiTool) std::cout << "Cambi utensile: " << gCodeViewer.getToolChanges() << "\n";
+        std::cout << "Stencil swept: " << st.hits << " da cache, " << st.misses << " calcolati (" << st.built << " stencil creati, "
+                  << st.evicted << " rimossi)\n";
+      }
+      if (streaming) {
+        std::cout << "G-code [stream]: " << streamStats.lines << " righe, " << streamStats.moves << " movimenti in "
+                  << streamStats.chunks << " blocchi | primo blocco dopo " << firstBatchMs << " ms, parsing "
+                  << streamStats.ms << " ms (sovrapposto al carving)\n";
+        std::cout << "Semplificazione (" << simplifyTol << " voxel): " << streamStats.moves << " -> " << keptMoves << " punti (riduzione "
+                  << (streamStats.moves ? 100.0 * (streamStats.moves - keptMoves) / streamStats.moves : 0.0) << "%)\n";
+      }
+
+      // The result buffers are moved out of the viewer into one shared object: the
+      // writer and (for the last run) the viewer both reference it, nothing is copied.
+      const bool last = (run == runs - 1);
+      if (saveOut || (last && showViewer)) {
+        SharedVoxelObject result = makeSharedVoxelObject(gCodeViewer.takeWorkpiece());
+        if (last && showViewer) carved = result;
+        if (saveOut) writer.submit(std::move(result), runs > 1 ? runOutputPath(outPath, run) : outPath);
       }
     }
-    // Wait for the GPU carving to actually complete, to measure the net carving time
-    // separately from copyBack. This sync is free: copyBack() syncs anyway, so the
-    // total is unchanged.
-    gCodeViewer.finishGPU();
-    auto tCarveDone = std::chrono::high_resolution_clock::now();
-
-    // Pull the carved workpiece back from the GPU to CPU memory (readback + GPU compaction).
-    gCodeViewer.copyBack();
-    auto tDone = std::chrono::high_resolution_clock::now();
-
-    const double carveMs = std::chrono::duration<double, std::milli>(tCarveDone - tStart).count();
-    const double totalMs = std::chrono::duration<double, std::milli>(tDone - tStart).count();
-    std::cout << "\n";  // terminate the in-place carving counter line
-    std::cout << "Carving [" << (legacy ? "legacy" : "swept") << "]: " << steps
-              << (legacy ? " passi" : " segmenti") << " | carving netto " << carveMs
-              << " ms | totale (incl. copyback) " << totalMs << " ms\n";
-
-    // Optionally persist the carved result (reuses BoolOps' .bin format).
-    if (args.has("--out")) {
-      const std::string outPath = args.get("--out", "");
-      if (gCodeViewer.saveWorkpiece(outPath))
-        std::cout << "Saved carved workpiece -> " << outPath << "\n";
+    writer.flush();
+    const double runsSec =
+        std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - tRunsStart).count();
+
+    for (const ResultWriter::Record& r : writer.records()) {
+      if (r.ok)
+        std::cout << "Saved carved workpiece -> " << r.path << " (" << r.bytes / (1024.0 * 1024.0) << " MB, fnv1a 0x"
+                  << std::hex << r.checksum << std::dec << ", " << r.writeMs << " ms)\n";
       else
-        std::cerr << "Failed to save carved workpiece to: " << outPath << "\n";
+        std::cerr << "Failed to save carved workpiece to: " << r.path << "\n";
     }
-
-    if (showViewer) carved = gCodeViewer.getWorkpiece();
+    if (!failed)
+      std::cout << "Throughput: " << runs << " risultati in " << runsSec << " s -> " << runs / runsSec
+                << " risultati/s\n";
 
     // TODO: Marching Cubes mesh extraction of the carved result is disabled here
     // (a face at the extreme X value does not generate a corresponding mesh face).
@@ -122,10 +409,11 @@ int runSimulate(const CliArgs& args) {
   }  // gCodeViewer destroyed here, while the context is still current
 
   destroyGLContext(window);
+  if (failed) return EXIT_FAILURE;
 
   if (showViewer) {
     // VoxelViewer manages its own OpenGL context/window (re-inits GLFW).
-    VoxelViewer viewer(carved.compressedData, carved.prefixSumData, carved.params);
+    VoxelViewer viewer(std::move(carved));
     viewer.run();
   }
 
@@ -10,6 +10,7 @@
 
 #include <iostream>
 #include <string>
+#include <utility>
 
 #include "GLUtils.hpp"
 #include "boolOps.hpp"  // BoolOps + VoxelObject
@@ -38,7 +39,7 @@ int runView(const CliArgs& args) {
   {
     BoolOps ops;
     ok = ops.load(binPath);
-    if (ok) obj = ops.getObjects()[0];
+    if (ok) obj = std::move(ops.getObjects()[0]);  // take the buffers, don't copy them
   }
   destroyGLContext(window);
 
@@ -48,7 +49,7 @@ int runView(const CliArgs& args) {
   }
 
   // VoxelViewer manages its own OpenGL context/window for the render loop.
-  VoxelViewer viewer(obj.compressedData, obj.prefixSumData, obj.params);
+  VoxelViewer viewer(makeSharedVoxelObject(std::move(obj)));
   viewer.setOrthographic(ortho);
   viewer.run();
   return EXIT_SUCCESS;
@@ -0,0 +1,210 @@
+// =============================================================================
+//  voxelize_batch_mode.cpp - `voxelize-batch` sub-command.
+//
+//  Voxelizes a whole library of meshes (a directory of .stl files, or a text
+//  file listing one mesh path per line) in one process:
+//    - one OpenGL context and one compilation of the voxelization programs
+//      serve every mesh (VoxelizerGL), instead of one per `voxelize` run;
+//    - without a GPU (or with --backend cpu) every mesh goes through the CPU
+//      voxelizer, which already spreads each mesh over all cores;
+//    - mesh N + 1 is loaded on a worker thread while mesh N is voxelized;
+//    - a CSV manifest records sizes and timings of every mesh;
+//    - every mesh is planned (memoryPlanner.hpp) before it is voxelized, and a
+//      mesh whose plan exceeds --ram-mb / --mem-mb is skipped instead of
+//      running the batch out of memory half-way through.
+//
+//  Usage:
+//    voxelize voxelize-batch <dir|list.txt> [--out-dir <dir>] [--res <float>] [--mem-mb <int>]
+//                            [--backend gpu|twopass|cpu] [--tile <px>] [--zsub <n>] [--manifest <file.csv>]
+//                            [--ram-mb <int>]
+// =============================================================================
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cli.hpp"
+#include "main_params.hpp"
+#include "memoryPlanner.hpp"
+#include "meshLoader.hpp"
+#include "modes.hpp"
+#include "utils.hpp"
+#include "voxelizer.hpp"
+#include "voxelizerUtils.hpp"
+
+namespace {
+
+// Meshes of a directory (.stl, sorted) or of a list file (one path per line, '#' comments).
+bool collectInputs(const std::string& source, std::vector<std::string>& inputs) {
+  std::error_code ec;
+  if (std::filesystem::is_directory(source, ec)) {
+    for (const auto& entry : std::filesystem::directory_iterator(source, ec)) {
+      std::string ext = entry.path().extension().string();
+      std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+      if (entry.is_regular_file() && ext == ".stl") inputs.push_back(entry.path().string());
+    }
+    std::sort(inputs.begin(), inputs.end());
+    return !ec;
+  }
+  std::ifstream list(source);
+  if (!list) return false;
+  std::string line;
+  while (std::getline(list, line)) {
+    line.erase(0, line.find_first_not_of(" \t\r"));
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+    if (!line.empty() && line[0] != '#') inputs.push_back(line);
+  }
+  return true;
+}
+
+// A text field of the CSV manifest: quoted, embedded quotes doubled (RFC 4180),
+// so paths and messages with commas, quotes or newlines stay one field.
+std::string csvField(const std::string& text) {
+  std::string out = "\"";
+  for (char c : text) {
+    if (c == '"') out += '"';
+    out += c;
+  }
+  return out + "\"";
+}
+
+struct LoadedMesh {
+  Mesh mesh;
+  double ms = 0.0;
+  std::string error;  // empty on success
+};
+
+LoadedMesh loadTimed(const std::string& path) {
+  LoadedMesh out;
+  auto t0 = std::chrono::high_resolution_clock::now();
+  try {
+    out.mesh = loadMesh(path.c_str());
+  } catch (const std::exception& e) {
+    out.error = e.what();
+  }
+  out.ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+  return out;
+}
+
+}  // namespace
+
+int runVoxelizeBatch(const CliArgs& args) {
+  if (args.positionals.empty()) {
+    std::cerr << "voxelize-batch: missing input directory or list file.\n";
+    printUsage();
+    return EXIT_FAILURE;
+  }
+  std::vector<std::string> inputs;
+  if (!collectInputs(args.positionals[0], inputs)) {
+    std::cerr << "voxelize-batch: cannot read " << args.positionals[0] << "\n";
+    return EXIT_FAILURE;
+  }
+  if (inputs.empty()) {
+    std::cerr << "voxelize-batch: no meshes in " << args.positionals[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  VoxelizationParams baseParams;
+  baseParams.resolution = args.getFloat("--res", RESOLUTION);
+  baseParams.color = WHITE;
+  baseParams.maxMemoryBudgetBytes = static_cast<size_t>(args.getInt("--mem-mb", DEFAULT_MEM_MB)) * 1024 * 1024;
+  const int tilePx = args.getInt("--tile", DEFAULT_TILE_PX);
+  MemoryBudget budget;
+  budget.ramBytes = static_cast<size_t>(args.getInt("--ram-mb", 0)) * 1024 * 1024;
+  const int zSub = args.getInt("--zsub", DEFAULT_ZSUB);
+  if (zSub < 1) {
+    std::cerr << "--zsub must be >= 1 (got " << zSub << ")\n";
+    return EXIT_FAILURE;
+  }
+  VoxelizerBackend backend;
+  if (!parseVoxelizerBackend(args.get("--backend", DEFAULT_VOXELIZER_BACKEND), backend)) {
+    std::cerr << "Unknown --backend value: " << args.get("--backend", "") << " (expected gpu, twopass or cpu)\n";
+    return EXIT_FAILURE;
+  }
+  const std::string outDir = args.get("--out-dir", "test");
+  std::error_code ec;
+  std::filesystem::create_directories(outDir, ec);
+  const std::string manifestPath = args.get("--manifest", (std::filesystem::path(outDir) / "manifest.csv").string());
+
+  // One context + one set of programs for the whole batch; no GPU -> CPU voxelizer.
+  std::unique_ptr<VoxelizerGL> gl;
+  if (backend != VoxelizerBackend::CPU) {
+    try {
+      gl = std::make_unique<VoxelizerGL>(64, 64);
+    } catch (const std::exception& e) {
+      std::cerr << "Nessuna GPU disponibile (" << e.what() << "): uso il backend cpu\n";
+      backend = VoxelizerBackend::CPU;
+    }
+  }
+
+  std::ofstream manifest(manifestPath);
+  if (!manifest) {
+    std::cerr << "voxelize-batch: cannot write manifest " << manifestPath << "\n";
+    return EXIT_FAILURE;
+  }
+  manifest << "input,output,triangles,res_x,res_y,res_z,transitions,load_ms,voxelize_ms,save_ms,status\n";
+
+  auto tBatch = std::chrono::high_resolution_clock::now();
+  size_t failed = 0;
+  std::future<LoadedMesh> next = std::async(std::launch::async, loadTimed, inputs[0]);
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    LoadedMesh loaded = next.get();
+    if (i + 1 < inputs.size()) next = std::async(std::launch::async, loadTimed, inputs[i + 1]);  // overlaps with this mesh
+
+    const std::string out = (std::filesystem::path(outDir) / stlToBinName(getFileNameFromPath(inputs[i]))).string();
+    std::cout << "[" << (i + 1) << "/" << inputs.size() << "] " << inputs[i] << "\n";
+    double voxelizeMs = 0.0, saveMs = 0.0;
+    glm::ivec3 res(0);
+    size_t transitions = 0;
+    std::string status = loaded.error.empty() ? "ok" : "load failed: " + loaded.error;
+    if (loaded.error.empty()) {
+      try {
+        auto t0 = std::chrono::high_resolution_clock::now();
+        Voxelizer voxelizer(loaded.mesh, baseParams);
+        voxelizer.setBackend(backend);
+        voxelizer.setSharedGL(gl.get());
+        voxelizer.setMaxTileSize(tilePx);
+        if (zSub > 1) voxelizer.setZSubdivision(zSub);
+        VoxelizationParams sized = voxelizer.getParams();
+        sized.slicesPerBlock = chooseOptimalPowerOfTwoSlicesPerBlock(sized, backend);
+        voxelizer.setParams(sized);
+        res = voxelizer.getResolutionPx();
+        // Plan the mesh before anything is allocated for it (same rules as `voxelize`).
+        budget.vramBytes = backend == VoxelizerBackend::CPU ? 0 : baseParams.maxMemoryBudgetBytes;
+        const MemoryPlan plan = planVoxelization(sized, backend, loaded.mesh.vertices.size() / 3, loaded.mesh.indices.size() / 3, tilePx, budget);
+        if ((!plan.fitsRam && args.has("--ram-mb")) || (!plan.fitsVram && args.has("--mem-mb"))) {
+          status = "skipped: memory plan over budget (RAM " + std::to_string(plan.peakRam >> 20) + " MB, VRAM " + std::to_string(plan.peakVram >> 20) +
+                   " MB)";
+        } else {
+          voxelizer.setWorkers(plan.workers);
+          voxelizer.run();
+          auto t1 = std::chrono::high_resolution_clock::now();
+          if (!voxelizer.save(out)) status = "save failed";
+          auto t2 = std::chrono::high_resolution_clock::now();
+          voxelizeMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+          saveMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+          transitions = voxelizer.getResults().first.size();
+        }
+      } catch (const std::exception& e) {
+        status = std::string("voxelize failed: ") + e.what();
+      }
+    }
+    if (status != "ok") {
+      ++failed;
+      std::cerr << "  " << status << "\n";
+    }
+    manifest << csvField(inputs[i]) << "," << csvField(out) << "," << loaded.mesh.indices.size() / 3 << "," << res.x << "," << res.y << "," << res.z << ","
+             << transitions << "," << loaded.ms << "," << voxelizeMs << "," << saveMs << "," << csvField(status) << "\n";
+  }
+
+  const double totalS = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - tBatch).count();
+  std::cout << "Batch: " << (inputs.size() - failed) << "/" << inputs.size() << " mesh voxelizzate in " << totalS << " s | manifest: " << manifestPath
+            << "\n";
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,11 +1,12 @@
 // =============================================================================
 //  voxelize_mode.cpp - `voxelize` sub-command.
 //
-//  Loads an STL mesh, voxelizes it on the GPU and saves the result as a .bin
-//  voxel object. Replaces the former VOXELIZATION_TESTING #ifdef block.
+//  Loads an STL mesh, voxelizes it (on the GPU, or on the CPU with --backend cpu)
+//  and saves the result as a .bin voxel object. Replaces the former VOXELIZATION_TESTING #ifdef block.
 //
 //  Usage:
-//    voxelize voxelize <input.stl> [--out <file.bin>] [--res <float>] [--mem-mb <int>]
+//    voxelize voxelize <input.stl> [--out <file.bin>] [--res <float>] [--mem-mb <int>] [--backend gpu|twopass|cpu] [--tile <px>]
+//                      [--zsub <n>] [--ram-mb <int>] [--plan]
 // =============================================================================
 
 #include <glm/glm.hpp>
@@ -14,6 +15,7 @@
 
 #include "cli.hpp"
 #include "main_params.hpp"
+#include "memoryPlanner.hpp"
 #include "meshLoader.hpp"
 #include "modes.hpp"
 #include "utils.hpp"
@@ -33,14 +35,58 @@ int runVoxelize(const CliArgs& args) {
   params.resolution = args.getFloat("--res", RESOLUTION);
   params.color = WHITE;
   params.maxMemoryBudgetBytes = static_cast<size_t>(args.getInt("--mem-mb", DEFAULT_MEM_MB)) * 1024 * 1024;
-  params.slicesPerBlock = chooseOptimalPowerOfTwoSlicesPerBlock(params);
+
+  const std::string backendName = args.get("--backend", DEFAULT_VOXELIZER_BACKEND);
+  VoxelizerBackend backend;
+  if (!parseVoxelizerBackend(backendName, backend)) {
+    std::cerr << "Unknown --backend value: " << backendName << " (expected gpu, twopass or cpu)\n";
+    return EXIT_FAILURE;
+  }
+  // --zsub n: Z slices n times finer than the XY voxel (fixed-point Z transitions).
+  const int zSub = args.getInt("--zsub", DEFAULT_ZSUB);
+  if (zSub < 1) {
+    std::cerr << "--zsub must be >= 1 (got " << zSub << ")\n";
+    return EXIT_FAILURE;
+  }
 
   // Default output: test/<stlname>.bin
   const std::string out = args.get("--out", "test/" + stlToBinName(getFileNameFromPath(input)));
 
-  // Voxelizer::run() creates and owns its own OpenGL context internally.
+  // The GPU backend creates and owns its own OpenGL context inside Voxelizer::run();
+  // the CPU backend needs none (GPU-less nodes).
   Mesh mesh = loadMesh(input.c_str());
   Voxelizer voxelizer(mesh, params);
+  voxelizer.setBackend(backend);
+  if (zSub > 1) voxelizer.setZSubdivision(zSub);
+
+  // Size the slice blocks for the real grid (known once the mesh is loaded) and backend.
+  // Grids above --tile px or the --mem-mb budget are voxelized in XY tiles (each tile
+  // then sizes its own blocks).
+  VoxelizationParams sized = voxelizer.getParams();
+  sized.slicesPerBlock = chooseOptimalPowerOfTwoSlicesPerBlock(sized, backend);
+  voxelizer.setParams(sized);
+  const int maxTilePx = args.getInt("--tile", DEFAULT_TILE_PX);
+  voxelizer.setMaxTileSize(maxTilePx);
+
+  // Memory plan (memoryPlanner.hpp) of the whole run against --ram-mb / --mem-mb,
+  // before anything is allocated: --plan prints it and stops.
+  MemoryBudget budget;
+  budget.ramBytes = static_cast<size_t>(args.getInt("--ram-mb", 0)) * 1024 * 1024;
+  budget.vramBytes = backend == VoxelizerBackend::CPU ? 0 : params.maxMemoryBudgetBytes;
+  const MemoryPlan plan = planVoxelization(sized, backend, mesh.vertices.size() / 3, mesh.indices.size() / 3, maxTilePx, budget);
+  if (args.has("--plan")) {
+    std::cout << "Memory plan (" << backendName << ", " << sized.resolutionXYZ.x << " x " << sized.resolutionXYZ.y << " x " << sized.resolutionXYZ.z
+              << " px):\n";
+    printMemoryPlan(plan, budget, std::cout);
+    return plan.fits() ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  std::cout << "Memory plan: peak RAM " << plan.peakRam / (1024.0 * 1024.0) << " MB, VRAM " << plan.peakVram / (1024.0 * 1024.0) << " MB\n";
+  if ((!plan.fitsRam && args.has("--ram-mb")) || (!plan.fitsVram && args.has("--mem-mb"))) {
+    std::cerr << "Voxelization does not fit the memory budget (see --plan).\n";
+    return EXIT_FAILURE;
+  }
+  if (!plan.fits()) std::cerr << "Warning: the memory plan exceeds the default budget (see --plan).\n";
+  voxelizer.setWorkers(plan.workers);
   voxelizer.run();
 
   if (!voxelizer.save(out)) {
@@ -0,0 +1,131 @@
+#include "resultWriter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+bool writeVoxelObject(const VoxelObject& obj, const std::string& path, uint64_t* checksum) {
+  if (obj.compressedData.empty() || obj.prefixSumData.empty()) {
+    std::cerr << "No data to save. Run voxelization first." << std::endl;
+    return false;
+  }
+
+  // Header: params + format tag + the two section sizes, encoded in one block.
+  const size_t dataSize = obj.compressedData.size() * sizeof(GLuint);
+  const size_t prefixSize = obj.prefixSumData.size() * sizeof(GLuint);
+  const VoxelFileTag tag = voxelFileTag(obj.params);
+  char header[voxelFileHeaderSize];
+  char* h = header;
+  h = std::copy_n(reinterpret_cast<const char*>(&obj.params), sizeof(VoxelizationParams), h);
+  h = std::copy_n(reinterpret_cast<const char*>(&tag), sizeof(VoxelFileTag), h);
+  h = std::copy_n(reinterpret_cast<const char*>(&dataSize), sizeof(size_t), h);
+  std::copy_n(reinterpret_cast<const char*>(&prefixSize), sizeof(size_t), h);
+
+  // Write next to the destination, so the rename below stays on one filesystem.
+  const std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      std::cerr << "Failed to open file for writing: " << tmpPath << std::endl;
+      return false;
+    }
+    file.write(header, sizeof(header));
+    file.write(reinterpret_cast<const char*>(obj.compressedData.data()), dataSize);
+    file.write(reinterpret_cast<const char*>(obj.prefixSumData.data()), prefixSize);
+    file.flush();
+    if (!file) {
+      std::cerr << "Failed to write data to file: " << tmpPath << std::endl;
+      std::remove(tmpPath.c_str());
+      return false;
+    }
+  }
+
+  if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+    std::cerr << "Failed to rename " << tmpPath << " -> " << path << std::endl;
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+
+  if (checksum) {
+    uint64_t h = fnv1a64(header, sizeof(header));
+    h = fnv1a64(obj.compressedData.data(), dataSize, h);
+    *checksum = fnv1a64(obj.prefixSumData.data(), prefixSize, h);
+  }
+  return true;
+}
+
+ResultWriter::ResultWriter(size_t maxQueued) : maxQueued(maxQueued > 0 ? maxQueued : 1) {
+  worker = std::thread(&ResultWriter::workerLoop, this);
+}
+
+ResultWriter::~ResultWriter() {
+  flush();
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    stopping = true;
+  }
+  cvWork.notify_all();
+  if (worker.joinable()) worker.join();
+}
+
+void ResultWriter::submit(VoxelObject&& obj, const std::string& path) { submit(makeSharedVoxelObject(std::move(obj)), path); }
+
+void ResultWriter::submit(SharedVoxelObject obj, const std::string& path) {
+  std::unique_lock<std::mutex> lock(mtx);
+  cvSpace.wait(lock, [this] { return queue.size() < maxQueued; });
+  queue.push_back(Job{std::move(obj), path});
+  ++inFlight;
+  lock.unlock();
+  cvWork.notify_one();
+}
+
+void ResultWriter::flush() {
+  std::unique_lock<std::mutex> lock(mtx);
+  cvIdle.wait(lock, [this] { return inFlight == 0; });
+}
+
+std::vector<ResultWriter::Record> ResultWriter::records() const {
+  std::lock_guard<std::mutex> lock(mtx);
+  return done;
+}
+
+size_t ResultWriter::failedCount() const {
+  std::lock_guard<std::mutex> lock(mtx);
+  size_t failed = 0;
+  for (const Record& r : done)
+    if (!r.ok) ++failed;
+  return failed;
+}
+
+void ResultWriter::workerLoop() {
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      cvWork.wait(lock, [this] { return stopping || !queue.empty(); });
+      if (queue.empty()) return;  // stopping and drained
+      job = std::move(queue.front());
+      queue.pop_front();
+    }
+    cvSpace.notify_one();  // a slot is free: the producer may continue
+
+    Record rec;
+    rec.path = job.path;
+    rec.bytes = voxelFileHeaderSize + (job.obj->compressedData.size() + job.obj->prefixSumData.size()) * sizeof(GLuint);
+    auto t0 = std::chrono::high_resolution_clock::now();
+    rec.ok = writeVoxelObject(*job.obj, job.path, &rec.checksum);
+    rec.writeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+
+    // Drop our reference before reporting completion (frees the buffers unless shared).
+    job.obj.reset();
+
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      done.push_back(std::move(rec));
+      --inFlight;
+    }
+    cvIdle.notify_all();
+  }
+}
@@ -0,0 +1,243 @@
+#include "stlLoader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cfloat>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <stdexcept>
+
+#include "mappedFile.hpp"
+#include "parallel.hpp"
+
+#define STL_HEADER_SIZE 84        // 80-byte header + uint32 triangle count
+#define STL_TRIANGLE_SIZE 50      // normal + 3 vertices (12 floats) + uint16 attribute
+#define ASCII_MIN_CHUNK (1 << 20)  // don't split ASCII files in chunks smaller than 1 MB
+
+bool isStlFile(const std::string& path) {
+  if (path.size() < 4) return false;
+  std::string ext = path.substr(path.size() - 4);
+  std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+  return ext == ".stl";
+}
+
+// ---------------------------------------------------------------------------
+// Binary STL
+// ---------------------------------------------------------------------------
+static std::vector<float> parseBinaryStl(const char* data, size_t numTriangles) {
+  std::vector<float> soup(numTriangles * 9);
+  parallelFor(
+      numTriangles,
+      [&](size_t b, size_t e, unsigned) {
+        for (size_t t = b; t < e; ++t) {
+          // Skip the facet normal (3 floats): it is recomputed/unused downstream.
+          const char* tri = data + STL_HEADER_SIZE + t * STL_TRIANGLE_SIZE + 3 * sizeof(float);
+          std::memcpy(&soup[t * 9], tri, 9 * sizeof(float));
+        }
+      },
+      workerCount(), 1 << 16);
+  return soup;
+}
+
+// ---------------------------------------------------------------------------
+// ASCII STL
+// ---------------------------------------------------------------------------
+static inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+static inline bool parseFloat(const char*& p, const char* end, float& out) {
+  while (p < end && isBlank(*p)) ++p;
+  if (p < end && *p == '+') ++p;  // from_chars rejects an explicit '+'
+  auto res = std::from_chars(p, end, out);
+  if (res.ec != std::errc()) return false;
+  p = res.ptr;
+  return true;
+}
+
+// Collect the "vertex x y z" lines of [b, e) (which starts at a line boundary).
+// Every other keyword (solid/facet/outer loop/endloop/endfacet/endsolid) is
+// skipped, so multi-solid files simply concatenate their facets.
+static bool parseAsciiRange(const char* b, const char* e, std::vector<float>& out) {
+  const char* p = b;
+  while (p < e) {
+    const char* eol = static_cast<const char*>(std::memchr(p, '\n', (size_t)(e - p)));
+    if (!eol) eol = e;
+    while (p < eol && isBlank(*p)) ++p;
+    if (eol - p > 6 && std::memcmp(p, "vertex", 6) == 0 && isBlank(p[6])) {
+      p += 6;
+      float x, y, z;
+      if (!parseFloat(p, eol, x) || !parseFloat(p, eol, y) || !parseFloat(p, eol, z)) return false;
+      out.push_back(x);
+      out.push_back(y);
+      out.push_back(z);
+    }
+    p = eol + 1;
+  }
+  return true;
+}
+
+static std::vector<float> parseAsciiStl(const char* data, size_t size) {
+  // Line-aligned chunks, one per worker.
+  unsigned workers = (unsigned)std::max<size_t>(1, std::min<size_t>(workerCount(), size / ASCII_MIN_CHUNK));
+  std::vector<const char*> cuts(workers + 1);
+  cuts[0] = data;
+  cuts[workers] = data + size;
+  for (unsigned i = 1; i < workers; ++i) {
+    const char* c = data + size * i / workers;
+    c = std::max(c, cuts[i - 1]);
+    const char* nl = static_cast<const char*>(std::memchr(c, '\n', (size_t)(data + size - c)));
+    cuts[i] = nl ? nl + 1 : data + size;
+  }
+
+  std::vector<std::vector<float>> parts(workers);
+  std::vector<char> ok(workers, 1);
+  parallelFor(workers, [&](size_t b, size_t e, unsigned) {
+    for (size_t i = b; i < e; ++i) {
+      parts[i].reserve((size_t)(cuts[i + 1] - cuts[i]) / 16);  // ~one float per 16 bytes of text
+      ok[i] = parseAsciiRange(cuts[i], cuts[i + 1], parts[i]);
+    }
+  });
+  for (char k : ok)
+    if (!k) throw std::runtime_error("Malformed ASCII STL vertex line");
+
+  size_t total = 0;
+  for (const auto& part : parts) total += part.size();
+  if (total % 9 != 0) throw std::runtime_error("ASCII STL vertex count is not a multiple of 3");
+
+  std::vector<float> soup;
+  soup.reserve(total);
+  for (const auto& part : parts) soup.insert(soup.end(), part.begin(), part.end());
+  return soup;
+}
+
+static std::vector<float> parseStl(const char* path) {
+  MappedFile file(path);
+  const char* data = file.data();
+  const size_t size = file.size();
+
+  // Binary files are identified by their exact size (some binary headers also
+  // start with "solid", so the keyword alone is not enough).
+  if (size >= STL_HEADER_SIZE) {
+    uint32_t count = 0;
+    std::memcpy(&count, data + 80, sizeof(count));
+    if ((uint64_t)STL_HEADER_SIZE + (uint64_t)STL_TRIANGLE_SIZE * count == size) return parseBinaryStl(data, count);
+  }
+
+  const char* p = data;
+  while (p < data + size && std::isspace((unsigned char)*p)) ++p;
+  if ((size_t)(data + size - p) >= 5 && std::memcmp(p, "solid", 5) == 0) return parseAsciiStl(data, size);
+
+  throw std::runtime_error(std::string("Not a valid STL file: ") + path);
+}
+
+std::vector<float> readStlTriangles(const char* path) {
+  // An empty soup is an error too: an ASCII file without facets, or a binary file
+  // whose header starts with "solid" but whose size doesn't match its count (so it
+  // was read as text), must not come back as a valid empty mesh.
+  std::vector<float> soup = parseStl(path);
+  if (soup.empty()) throw std::runtime_error(std::string("No triangles in STL file: ") + path);
+  return soup;
+}
+
+// ---------------------------------------------------------------------------
+// Vertex welding (hash grid)
+// ---------------------------------------------------------------------------
+using CellKey = std::array<int32_t, 3>;
+
+static inline uint64_t hashKey(const CellKey& k) {
+  uint64_t h = (uint64_t)(uint32_t)k[0] * 0x9E3779B185EBCA87ULL;
+  h ^= (uint64_t)(uint32_t)k[1] * 0xC2B2AE3D27D4EB4FULL;
+  h ^= (uint64_t)(uint32_t)k[2] * 0x165667B19E3779F9ULL;
+  return h ^ (h >> 29);
+}
+
+Mesh weldTriangles(const std::vector<float>& soup, float cell) {
+  Mesh mesh;
+  const size_t numVerts = soup.size() / 3;
+  if (numVerts == 0) return mesh;
+
+  glm::vec3 minV(FLT_MAX), maxV(-FLT_MAX);
+  for (size_t i = 0; i < numVerts; ++i) {
+    glm::vec3 v(soup[3 * i], soup[3 * i + 1], soup[3 * i + 2]);
+    minV = glm::min(minV, v);
+    maxV = glm::max(maxV, v);
+  }
+  if (cell <= 0.0f) cell = std::max(glm::length(maxV - minV) * 1e-6f, FLT_MIN);
+  const float invCell = 1.0f / cell;
+
+  // Quantize every vertex to its grid cell (parallel; the insertion below is
+  // sequential so the welded vertex order is deterministic).
+  std::vector<CellKey> keys(numVerts);
+  parallelFor(
+      numVerts,
+      [&](size_t b, size_t e, unsigned) {
+        for (size_t i = b; i < e; ++i)
+          for (int a = 0; a < 3; ++a) keys[i][a] = (int32_t)std::floor((soup[3 * i + a] - minV[a]) * invCell);
+      },
+      workerCount(), 1 << 16);
+
+  // Open-addressing table of occupied cells, load factor <= 0.5. The welded
+  // vertices of a cell are chained through `next`, starting at cellHead.
+  size_t tableSize = 1;
+  while (tableSize < 2 * numVerts) tableSize <<= 1;
+  const uint32_t EMPTY = 0xFFFFFFFFu;
+  std::vector<uint32_t> table(tableSize, EMPTY);
+  std::vector<CellKey> cellKeys;
+  std::vector<uint32_t> cellHead, next;
+  std::vector<uint32_t> remap(numVerts);
+  auto slotOf = [&](const CellKey& k) {
+    size_t h = hashKey(k) & (tableSize - 1);
+    while (table[h] != EMPTY && cellKeys[table[h]] != k) h = (h + 1) & (tableSize - 1);
+    return h;
+  };
+
+  // The vertex's own cell first (exact duplicates, the common case), then its 26
+  // neighbours: a vertex within `cell` may sit across any face, edge or corner.
+  std::array<CellKey, 27> offsets;
+  offsets[0] = CellKey{0, 0, 0};
+  for (int n = 0, o = 1; n < 27; ++n)
+    if (n != 13) offsets[o++] = CellKey{n % 3 - 1, n / 3 % 3 - 1, n / 9 - 1};
+
+  const float cell2 = cell * cell;
+  for (size_t i = 0; i < numVerts; ++i) {
+    const glm::vec3 v(soup[3 * i], soup[3 * i + 1], soup[3 * i + 2]);
+    uint32_t match = EMPTY;
+    for (const CellKey& d : offsets) {
+      const size_t h = slotOf(CellKey{keys[i][0] + d[0], keys[i][1] + d[1], keys[i][2] + d[2]});
+      if (table[h] == EMPTY) continue;
+      for (uint32_t w = cellHead[table[h]]; w != EMPTY && match == EMPTY; w = next[w]) {
+        const glm::vec3 u(mesh.vertices[3 * w], mesh.vertices[3 * w + 1], mesh.vertices[3 * w + 2]);
+        if (glm::dot(u - v, u - v) <= cell2) match = w;
+      }
+      if (match != EMPTY) break;
+    }
+    if (match == EMPTY) {
+      match = (uint32_t)next.size();
+      mesh.vertices.insert(mesh.vertices.end(), &soup[3 * i], &soup[3 * i] + 3);
+      const size_t h = slotOf(keys[i]);
+      if (table[h] == EMPTY) {
+        table[h] = (uint32_t)cellKeys.size();
+        cellKeys.push_back(keys[i]);
+        cellHead.push_back(EMPTY);
+      }
+      next.push_back(cellHead[table[h]]);
+      cellHead[table[h]] = match;
+    }
+    remap[i] = match;
+  }
+
+  mesh.indices.reserve(numVerts);
+  for (size_t t = 0; t + 2 < numVerts; t += 3) {
+    uint32_t a = remap[t], b = remap[t + 1], c = remap[t + 2];
+    if (a == b || b == c || a == c) continue;  // collapsed by welding
+    mesh.indices.push_back(a);
+    mesh.indices.push_back(b);
+    mesh.indices.push_back(c);
+  }
+  return mesh;
+}
+
+Mesh loadStl(const char* path) { return weldTriangles(readStlTriangles(path)); }
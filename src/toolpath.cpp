@@ -0,0 +1,274 @@
+#include "toolpath.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "gcodeParser.hpp"
+#include "hash.hpp"
+#include "mappedFile.hpp"
+#include "parallel.hpp"
+
+#define TOOLPATH_CACHE_MAGIC "ACTP"
+#define TOOLPATH_CACHE_VERSION 3u        // bump whenever the compiled form/semantics change
+#define TOOLPATH_HASH_BLOCK (4u << 20)  // content hash block (independent of the thread count)
+#define SIMPLIFY_MAX_RUN (1u << 16)      // bound Douglas-Peucker's worst case on very long runs
+#define SIMPLIFY_COLLINEAR 1e-3f         // collinear merge tolerance, fraction of the total tolerance
+
+// Content hash of the program: FNV-1a of every 4 MB block (in parallel), then
+// of the block hashes, the size, the compile options and the cache format version.
+static uint64_t contentKey(const char* data, size_t size, const ToolpathOptions& opts) {
+  const size_t numBlocks = (size + TOOLPATH_HASH_BLOCK - 1) / TOOLPATH_HASH_BLOCK;
+  std::vector<uint64_t> blockHash(numBlocks);
+  parallelFor(numBlocks, [&](size_t b, size_t e, unsigned) {
+    for (size_t i = b; i < e; ++i) {
+      size_t off = i * TOOLPATH_HASH_BLOCK;
+      blockHash[i] = fnv1a64(data + off, std::min<size_t>(TOOLPATH_HASH_BLOCK, size - off));
+    }
+  });
+
+  const uint32_t version = TOOLPATH_CACHE_VERSION;
+  uint64_t h = fnv1a64(&version, sizeof(version));
+  h = fnv1a64(&size, sizeof(size), h);
+  h = fnv1a64(&opts.arcTolerance, sizeof(opts.arcTolerance), h);  // field by field: no padding bytes
+  h = fnv1a64(&opts.blockDelete, sizeof(opts.blockDelete), h);
+  return fnv1a64(blockHash.data(), blockHash.size() * sizeof(uint64_t), h);
+}
+
+template <typename T>
+static void writeArray(std::ofstream& f, const std::vector<T>& v) {
+  f.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+template <typename T>
+static void readArray(std::ifstream& f, std::vector<T>& v) {
+  f.read(reinterpret_cast<char*>(v.data()), v.size() * sizeof(T));
+}
+
+bool saveCompiledToolpath(const CompiledToolpath& tp, const std::string& path) {
+  const std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream f(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!f) {
+      std::cerr << "Failed to open file for writing: " << tmpPath << std::endl;
+      return false;
+    }
+    const uint32_t version = TOOLPATH_CACHE_VERSION;
+    const uint64_t count = tp.size();
+    f.write(TOOLPATH_CACHE_MAGIC, 4);
+    f.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    f.write(reinterpret_cast<const char*>(&tp.key), sizeof(tp.key));
+    f.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    writeArray(f, tp.x), writeArray(f, tp.y), writeArray(f, tp.z);
+    writeArray(f, tp.moveType), writeArray(f, tp.feed), writeArray(f, tp.tool), writeArray(f, tp.line);
+    if (!f.flush()) {
+      std::remove(tmpPath.c_str());
+      return false;
+    }
+  }
+  if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool loadCompiledToolpath(const std::string& path, uint64_t expectedKey, CompiledToolpath& tp) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f) return false;
+
+  char magic[4];
+  uint32_t version = 0;
+  uint64_t key = 0, count = 0;
+  f.read(magic, 4);
+  f.read(reinterpret_cast<char*>(&version), sizeof(version));
+  f.read(reinterpret_cast<char*>(&key), sizeof(key));
+  f.read(reinterpret_cast<char*>(&count), sizeof(count));
+  if (!f || std::memcmp(magic, TOOLPATH_CACHE_MAGIC, 4) != 0 || version != TOOLPATH_CACHE_VERSION || key != expectedKey) return false;
+
+  // The arrays are only sized once `count` matches the rest of the file exactly:
+  // a truncated or corrupt entry is a cache miss, not a huge allocation.
+  const std::streamoff header = f.tellg();
+  f.seekg(0, std::ios::end);
+  const uint64_t remaining = (uint64_t)(f.tellg() - header);
+  f.seekg(header);
+  const uint64_t moveBytes = sizeof(tp.x[0]) + sizeof(tp.y[0]) + sizeof(tp.z[0]) + sizeof(tp.moveType[0]) + sizeof(tp.feed[0]) + sizeof(tp.tool[0]) +
+                             sizeof(tp.line[0]);
+  if (!f || count != remaining / moveBytes || remaining % moveBytes != 0) return false;
+
+  tp.resize(count);
+  readArray(f, tp.x), readArray(f, tp.y), readArray(f, tp.z);
+  readArray(f, tp.moveType), readArray(f, tp.feed), readArray(f, tp.tool), readArray(f, tp.line);
+  if (!f) {
+    tp.clear();
+    return false;
+  }
+  tp.key = key;
+  return true;
+}
+
+void transformToolpath(CompiledToolpath& tp, const ToolpathTransform& xf) {
+  if (xf.isIdentity()) return;
+  parallelFor(
+      tp.size(),
+      [&](size_t b, size_t e, unsigned) {
+        for (size_t i = b; i < e; ++i) {
+          tp.x[i] = tp.x[i] * xf.scale.x + xf.offset.x;
+          tp.y[i] = tp.y[i] * xf.scale.y + xf.offset.y;
+          tp.z[i] = tp.z[i] * xf.scale.z + xf.offset.z;
+        }
+      },
+      workerCount(), 1 << 16);
+}
+
+// ---------------------------------------------------------------------------
+// Simplification
+// ---------------------------------------------------------------------------
+
+// Distance from p to the segment [a, b].
+static float pointSegmentDistance(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b) {
+  const glm::vec3 ab = b - a;
+  const float len2 = glm::dot(ab, ab);
+  const float t = len2 > 0.0f ? glm::clamp(glm::dot(p - a, ab) / len2, 0.0f, 1.0f) : 0.0f;
+  return glm::length(p - (a + t * ab));
+}
+
+// Moves i and j can be merged: same kind (rapid vs cutting), feed and tool.
+static bool sameRun(const CompiledToolpath& tp, size_t i, size_t j) {
+  const bool rapidI = tp.motion(i) == MotionMode::RAPID, rapidJ = tp.motion(j) == MotionMode::RAPID;
+  return rapidI == rapidJ && tp.feed[i] == tp.feed[j] && tp.tool[i] == tp.tool[j];
+}
+
+// Douglas-Peucker over the candidate points pts[0..n) (indices into tp), marking
+// the points to keep. pts[0] and pts[n-1] are kept by the caller.
+static void douglasPeucker(const CompiledToolpath& tp, const std::vector<uint32_t>& pts, float tol, std::vector<uint8_t>& keep) {
+  std::vector<std::pair<size_t, size_t>> stack;
+  stack.emplace_back(0, pts.size() - 1);
+  while (!stack.empty()) {
+    auto [a, c] = stack.back();
+    stack.pop_back();
+    if (c <= a + 1) continue;
+    const glm::vec3 pa = tp.position(pts[a]), pc = tp.position(pts[c]);
+    float maxDist = -1.0f;
+    size_t m = a;
+    for (size_t k = a + 1; k < c; ++k) {
+      const float d = pointSegmentDistance(tp.position(pts[k]), pa, pc);
+      if (d > maxDist) maxDist = d, m = k;
+    }
+    if (maxDist <= tol) continue;
+    keep[pts[m]] = 1;
+    stack.emplace_back(a, m);
+    stack.emplace_back(m, c);
+  }
+}
+
+void simplifyToolpath(const CompiledToolpath& in, CompiledToolpath& out, float tolerance) {
+  const size_t n = in.size();
+  if (tolerance <= 0.0f || n < 3) {
+    out = in;
+    return;
+  }
+
+  // The collinear merge spends a tiny share of the budget, Douglas-Peucker the rest,
+  // so the two errors together stay within `tolerance`.
+  const float collinearTol = tolerance * SIMPLIFY_COLLINEAR;
+  const float dpTol = tolerance - collinearTol;
+
+  std::vector<uint8_t> keep(n, 0);
+  std::vector<uint32_t> pts;
+  keep[0] = keep[n - 1] = 1;
+  // Point i ends move i. A run [a, c] is a maximal range whose moves a+1..c can be
+  // merged; consecutive runs share their boundary point, which is always kept.
+  for (size_t a = 0; a + 1 < n;) {
+    size_t c = a + 1;
+    while (c + 1 < n && sameRun(in, a + 1, c + 1) && c + 1 - a <= SIMPLIFY_MAX_RUN) ++c;
+    keep[a] = keep[c] = 1;
+
+    // Collinear merge: from the last candidate L, follow the line through the next
+    // point while the points stay within collinearTol / 2 of it and keep moving
+    // forward (no reversal); the stretch then collapses to one segment whose points
+    // are all within collinearTol of it.
+    pts.clear();
+    pts.push_back((uint32_t)a);
+    for (size_t k = a + 1; k < c;) {
+      const glm::vec3 L = in.position(pts.back());
+      const glm::vec3 d = in.position(k) - L;
+      const float len = glm::length(d);
+      if (len == 0.0f) {  // duplicate point
+        ++k;
+        continue;
+      }
+      const glm::vec3 dir = d / len;
+      size_t j = k;
+      float lastProj = len;
+      while (j < c) {
+        const glm::vec3 v = in.position(j + 1) - L;
+        const float proj = glm::dot(v, dir);
+        if (proj < lastProj || glm::length(v - proj * dir) > 0.5f * collinearTol) break;
+        lastProj = proj;
+        ++j;
+      }
+      if (j < c) pts.push_back((uint32_t)j);
+      k = j + 1;
+    }
+    pts.push_back((uint32_t)c);
+
+    douglasPeucker(in, pts, dpTol, keep);
+    a = c;
+  }
+
+  size_t m = 0;
+  for (uint8_t k : keep) m += k;
+  out.resize(m);
+  out.key = in.key;
+  for (size_t i = 0, o = 0; i < n; ++i) {
+    if (!keep[i]) continue;
+    out.x[o] = in.x[i], out.y[o] = in.y[i], out.z[o] = in.z[i];
+    out.moveType[o] = in.moveType[i], out.feed[o] = in.feed[i], out.tool[o] = in.tool[i], out.line[o] = in.line[i];
+    ++o;
+  }
+}
+
+bool compileToolpath(const std::string& gcodePath, CompiledToolpath& out, const ToolpathOptions& opts, const std::string& cacheDir,
+                     GcodeParseStats* stats, bool* fromCache) {
+  if (fromCache) *fromCache = false;
+  try {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    MappedFile file(gcodePath);
+    const uint64_t key = contentKey(file.data(), file.size(), opts);
+
+    std::string cachePath;
+    if (!cacheDir.empty()) {
+      char name[32];
+      std::snprintf(name, sizeof(name), "%016llx.tp", (unsigned long long)key);
+      cachePath = (std::filesystem::path(cacheDir) / name).string();
+      if (loadCompiledToolpath(cachePath, key, out)) {
+        if (fromCache) *fromCache = true;
+        if (stats) {
+          *stats = GcodeParseStats();
+          stats->bytes = file.size();
+          stats->moves = out.size();
+          stats->ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();  // hash + load
+        }
+        return true;
+      }
+    }
+
+    parseGcodeBuffer(file.data(), file.size(), out, opts, stats);
+    out.key = key;
+
+    if (!cachePath.empty()) {
+      std::error_code ec;
+      std::filesystem::create_directories(cacheDir, ec);
+      if (ec || !saveCompiledToolpath(out, cachePath)) std::cerr << "Warning: could not write toolpath cache " << cachePath << std::endl;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Failed to compile G-code file: " << e.what() << std::endl;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,55 @@
+#include "toolpathCursor.hpp"
+
+#include <algorithm>
+
+ToolpathCursor::ToolpathCursor(const CompiledToolpath& toolpath) : path(toolpath) {
+  arcLength.resize(path.size());
+  double s = 0.0;
+  for (size_t i = 0; i < path.size(); ++i) {
+    if (i > 0) s += glm::length(path.position(i) - path.position(i - 1));
+    arcLength[i] = s;
+  }
+  reset();
+}
+
+void ToolpathCursor::reset() {
+  segment = 0;
+  along = 0.0;
+  publish(path.empty() ? glm::vec3(0.0f) : path.position(0));
+}
+
+size_t ToolpathCursor::advance(float step, float* x, float* y, float* z, size_t capacity) {
+  if (!(step > 0.0f)) return 0;
+  size_t n = 0;
+  glm::vec3 last(0.0f);
+  while (n < capacity && !done()) {
+    const double len = arcLength[segment + 1] - arcLength[segment];
+    if (len < 1e-6) {  // coincident points: nothing to stamp
+      ++segment;
+      along = 0.0;
+      continue;
+    }
+    along += step;
+    if (along >= len - 1e-4) {  // segment end (always sampled)
+      last = path.position(segment + 1);
+      ++segment;
+      along = 0.0;
+    } else {
+      last = glm::mix(path.position(segment), path.position(segment + 1), (float)(along / len));
+    }
+    x[n] = last.x;
+    y[n] = last.y;
+    z[n] = last.z;
+    ++n;
+  }
+  if (n > 0) publish(last);
+  return n;
+}
+
+void ToolpathCursor::publish(const glm::vec3& p) {
+  Snapshot s;
+  s.position = p;
+  s.segment = segment;
+  s.distance = segment < arcLength.size() ? std::min(arcLength[segment] + along, length()) : length();
+  published.store(s);
+}
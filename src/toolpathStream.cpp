@@ -0,0 +1,64 @@
+#include "toolpathStream.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <utility>
+
+ToolpathStream::ToolpathStream(const std::string& gcodePath, const ToolpathOptions& opts, const ToolpathTransform& xf, float simplifyTolerance,
+                               size_t batches)
+    : file(gcodePath), opts(opts), xf(xf), simplifyTolerance(simplifyTolerance), pool(std::max<size_t>(2, batches)), fullSlots(pool.size()), freeSlots(pool.size()) {
+  for (uint32_t i = 0; i < pool.size(); ++i) freeSlots.push(i);
+  t0 = std::chrono::high_resolution_clock::now();
+  producer = std::thread(&ToolpathStream::produce, this);
+}
+
+ToolpathStream::~ToolpathStream() {
+  cancel = true;
+  if (producer.joinable()) producer.join();
+}
+
+void ToolpathStream::produce() {
+  bool first = true;
+  parseGcodeStream(
+      file.data(), file.size(),
+      [&](CompiledToolpath& batch) {
+        transformToolpath(batch, xf);
+        if (simplifyTolerance > 0.0f) {
+          simplifyToolpath(batch, simplified, simplifyTolerance);
+          std::swap(batch, simplified);  // the parser refills whichever buffer it gets back
+        }
+        kept += batch.size();
+        uint32_t slot;
+        while (!freeSlots.pop(slot)) {
+          if (cancel) return false;
+          std::this_thread::yield();
+        }
+        std::swap(pool[slot], batch);  // hand the filled buffer over, refill the recycled one
+        if (first) {
+          firstMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+          first = false;
+        }
+        fullSlots.push(slot);  // never full: the pool has as many buffers as the ring has slots
+        return true;
+      },
+      opts, &parseStats);
+  done.store(true, std::memory_order_release);
+}
+
+const CompiledToolpath* ToolpathStream::next() {
+  if (current >= 0) freeSlots.push((uint32_t)current);
+  current = -1;
+
+  uint32_t slot;
+  for (;;) {
+    if (fullSlots.pop(slot)) break;
+    if (done.load(std::memory_order_acquire)) {
+      if (fullSlots.pop(slot)) break;  // pushed just before `done`
+      return nullptr;
+    }
+    std::this_thread::yield();
+  }
+  current = slot;
+  return &pool[slot];
+}
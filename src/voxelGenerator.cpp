@@ -0,0 +1,297 @@
+#include "voxelGenerator.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+struct Interval {
+  double a, b;  // solid for a <= z < b
+};
+
+inline double radiusOf(const Primitive& p) { return 0.5 * p.diameter; }
+
+// XY bounding box [x0, x1] x [y0, y1] and Z range of a primitive.
+void bounds(const Primitive& p, glm::dvec3& lo, glm::dvec3& hi) {
+  const glm::dvec3 o(p.origin);
+  if (p.kind == PrimitiveKind::BOX) {
+    lo = o - glm::dvec3(0.5 * p.size.x, 0.5 * p.size.y, 0.0);
+    hi = o + glm::dvec3(0.5 * p.size.x, 0.5 * p.size.y, p.size.z);
+  } else {
+    const double r = radiusOf(p);
+    lo = o - glm::dvec3(r, r, 0.0);
+    hi = o + glm::dvec3(r, r, p.length);
+  }
+}
+
+// Solid Z interval of primitive `p` in the column through (x, y), if any.
+bool columnInterval(const Primitive& p, double x, double y, Interval& out) {
+  const double dx = x - p.origin.x, dy = y - p.origin.y, oz = p.origin.z;
+  if (p.kind == PrimitiveKind::BOX) {
+    if (std::abs(dx) > 0.5 * p.size.x || std::abs(dy) > 0.5 * p.size.y) return false;
+    out = Interval{oz, oz + p.size.z};
+    return true;
+  }
+  const double R = radiusOf(p), r2 = dx * dx + dy * dy;
+  if (r2 > R * R) return false;
+  const double r = std::sqrt(r2);
+  double bottom = 0.0;  // height of the cutter profile above the tip at radius r
+  switch (p.kind) {
+    case PrimitiveKind::BALL_MILL: bottom = R - std::sqrt(std::max(0.0, R * R - r2)); break;
+    case PrimitiveKind::BULL_MILL: {
+      const double rc = std::min<double>(p.cornerRadius, R), d = r - (R - rc);
+      if (d > 0.0) bottom = rc - std::sqrt(std::max(0.0, rc * rc - d * d));
+      break;
+    }
+    case PrimitiveKind::V_BIT: bottom = r / std::tan(0.5 * glm::radians((double)p.tipAngle)); break;
+    default: break;  // CYLINDER, FLAT_MILL
+  }
+  if (bottom >= p.length) return false;
+  out = Interval{oz + bottom, oz + p.length};
+  return true;
+}
+
+// Sorted, disjoint interval list <- list + iv.
+void unite(std::vector<Interval>& list, Interval iv) {
+  size_t i = 0;
+  while (i < list.size() && list[i].b < iv.a) ++i;
+  size_t j = i;
+  while (j < list.size() && list[j].a <= iv.b) {
+    iv.a = std::min(iv.a, list[j].a);
+    iv.b = std::max(iv.b, list[j].b);
+    ++j;
+  }
+  list.erase(list.begin() + i, list.begin() + j);
+  list.insert(list.begin() + i, iv);
+}
+
+// Sorted, disjoint interval list <- list - iv.
+void subtract(std::vector<Interval>& list, const Interval& iv, std::vector<Interval>& scratch) {
+  scratch.clear();
+  for (const Interval& s : list) {
+    if (s.b <= iv.a || s.a >= iv.b) {
+      scratch.push_back(s);
+      continue;
+    }
+    if (s.a < iv.a) scratch.push_back(Interval{s.a, iv.a});
+    if (s.b > iv.b) scratch.push_back(Interval{iv.b, s.b});
+  }
+  list.swap(scratch);
+}
+
+// Append the transitions of one column (intervals sorted by increasing z).
+// Slice k (z = zTop - k * dz) is solid when a <= z < b for some interval;
+// slice 0 is always empty. Returns the number of transitions.
+uint32_t columnTransitions(const std::vector<Interval>& list, double zTop, double dz, long resZ, std::vector<uint32_t>& out) {
+  uint32_t count = 0;
+  long runStart = -1, runEnd = -1;
+  for (size_t i = list.size(); i-- > 0;) {
+    const long k0 = std::max(1L, (long)std::floor((zTop - list[i].b) / dz) + 1);
+    const long k1 = std::min(resZ - 1, (long)std::floor((zTop - list[i].a) / dz));
+    if (k0 > k1) continue;
+    if (runStart >= 0 && k0 <= runEnd + 1) {
+      runEnd = std::max(runEnd, k1);
+      continue;
+    }
+    if (runStart >= 0) {
+      out.push_back((uint32_t)(runStart - 1));
+      out.push_back((uint32_t)runEnd);
+      count += 2;
+    }
+    runStart = k0;
+    runEnd = k1;
+  }
+  if (runStart >= 0) {
+    out.push_back((uint32_t)(runStart - 1));
+    out.push_back((uint32_t)runEnd);
+    count += 2;
+  }
+  return count;
+}
+
+bool parseNumbers(const std::string& text, std::vector<float>& values) {
+  values.clear();
+  std::stringstream ss(text);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    try {
+      size_t used = 0;
+      values.push_back(std::stof(item, &used));
+      if (used != item.size()) return false;
+    } catch (const std::exception&) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+bool parsePrimitive(const std::string& spec, Primitive& out) {
+  out = Primitive();
+  std::string s = spec;
+  if (!s.empty() && (s[0] == '+' || s[0] == '-')) {
+    out.subtract = s[0] == '-';
+    s.erase(0, 1);
+  }
+  const size_t colon = s.find(':');
+  if (colon == std::string::npos) return false;
+  const std::string kind = s.substr(0, colon);
+  std::string args = s.substr(colon + 1), at;
+  const size_t atPos = args.find('@');
+  if (atPos != std::string::npos) {
+    at = args.substr(atPos + 1);
+    args.erase(atPos);
+  }
+
+  std::vector<float> v;
+  if (!parseNumbers(args, v)) return false;
+  if (!at.empty()) {
+    std::vector<float> o;
+    if (!parseNumbers(at, o) || o.size() != 3) return false;
+    out.origin = glm::vec3(o[0], o[1], o[2]);
+  }
+
+  if (kind == "box" && v.size() == 3) {
+    out.kind = PrimitiveKind::BOX;
+    out.size = glm::vec3(v[0], v[1], v[2]);
+    return v[0] > 0.0f && v[1] > 0.0f && v[2] > 0.0f;
+  }
+  if ((kind == "cyl" || kind == "flat" || kind == "ball") && v.size() == 2) {
+    out.kind = kind == "cyl" ? PrimitiveKind::CYLINDER : kind == "flat" ? PrimitiveKind::FLAT_MILL : PrimitiveKind::BALL_MILL;
+    out.diameter = v[0];
+    out.length = v[1];
+  } else if (kind == "bull" && v.size() == 3) {
+    out.kind = PrimitiveKind::BULL_MILL;
+    out.diameter = v[0];
+    out.cornerRadius = v[1];
+    out.length = v[2];
+    if (v[1] < 0.0f || v[1] > 0.5f * v[0]) return false;
+  } else if (kind == "vbit" && v.size() == 3) {
+    out.kind = PrimitiveKind::V_BIT;
+    out.diameter = v[0];
+    out.tipAngle = v[1];
+    out.length = v[2];
+    if (v[1] <= 0.0f || v[1] >= 180.0f) return false;
+  } else {
+    return false;
+  }
+  return out.diameter > 0.0f && out.length > 0.0f;
+}
+
+bool generateVoxelObject(const std::vector<Primitive>& primitives, float resolution, VoxelObject& out, int zSub, GenerateStats* stats,
+                         unsigned workers) {
+  auto t0 = std::chrono::high_resolution_clock::now();
+  if (resolution <= 0.0f) {
+    std::cerr << "Invalid resolution: " << resolution << std::endl;
+    return false;
+  }
+  if (zSub < 1 || zSub > UINT16_MAX) {
+    std::cerr << "Invalid Z subdivision: " << zSub << std::endl;
+    return false;
+  }
+
+  // Grid: the bounding box of the union primitives (differences never grow it).
+  const size_t n = primitives.size();
+  std::vector<glm::dvec3> lo(n), hi(n);
+  glm::dvec3 gridLo(1e300), gridHi(-1e300);
+  for (size_t i = 0; i < n; ++i) {
+    bounds(primitives[i], lo[i], hi[i]);
+    if (!primitives[i].subtract) {
+      gridLo = glm::min(gridLo, lo[i]);
+      gridHi = glm::max(gridHi, hi[i]);
+    }
+  }
+  if (gridLo.x > gridHi.x) {
+    std::cerr << "Nothing to generate: no union primitive." << std::endl;
+    return false;
+  }
+
+  const double res = resolution, dz = res / zSub;
+  const glm::dvec3 extent = gridHi - gridLo, center = 0.5 * (gridLo + gridHi);
+  const glm::ivec3 resXYZ(std::max(1, (int)std::ceil(extent.x / res - 1e-6)), std::max(1, (int)std::ceil(extent.y / res - 1e-6)),
+                          std::max(1, (int)std::ceil(extent.z / dz - 1e-6)));
+  const glm::dvec3 size = glm::dvec3(resXYZ) * glm::dvec3(res, res, dz);  // grid snapped to whole voxels, same centre
+  const double xLeft = center.x - 0.5 * size.x, yBottom = center.y - 0.5 * size.y, zTop = center.z + 0.5 * size.z;
+
+  const int resX = resXYZ.x, resY = resXYZ.y;
+  const size_t totalPixels = size_t(resX) * size_t(resY);
+  std::vector<uint32_t>& prefix = out.prefixSumData;
+  std::vector<uint32_t>& compressed = out.compressedData;
+  prefix.assign(totalPixels, 0);
+
+  // One row per task: the primitives whose Y range covers the row, then every
+  // column's interval list, then its transitions.
+  std::vector<std::vector<uint32_t>> rowData(resY);
+  std::vector<int> maxPerWorker(std::max(1u, workers), 0);
+  const unsigned used = parallelFor(
+      resY,
+      [&](size_t b, size_t e, unsigned w) {
+        std::vector<size_t> active;
+        std::vector<Interval> list, scratch;
+        for (size_t y = b; y < e; ++y) {
+          const double py = yBottom + (y + 0.5) * res;
+          active.clear();
+          for (size_t i = 0; i < n; ++i)
+            if (py >= lo[i].y && py <= hi[i].y) active.push_back(i);
+          if (active.empty()) continue;
+
+          std::vector<uint32_t>& rowOut = rowData[y];
+          uint32_t* counts = &prefix[y * size_t(resX)];
+          for (int x = 0; x < resX; ++x) {
+            const double px = xLeft + (x + 0.5) * res;
+            list.clear();
+            for (size_t i : active) {
+              if (px < lo[i].x || px > hi[i].x) continue;
+              Interval iv;
+              if (!columnInterval(primitives[i], px, py, iv)) continue;
+              if (primitives[i].subtract) {
+                if (!list.empty()) subtract(list, iv, scratch);
+              } else {
+                unite(list, iv);
+              }
+            }
+            if (list.empty()) continue;
+            counts[x] = columnTransitions(list, zTop, dz, resXYZ.z, rowOut);
+            maxPerWorker[w] = std::max(maxPerWorker[w], (int)counts[x]);
+          }
+        }
+      },
+      workers);
+
+  // Exclusive prefix sum (on all cores), then every row is copied to its final place.
+  const size_t total = parallelExclusiveScan(prefix.data(), totalPixels, workers);
+  compressed.resize(total);
+  parallelFor(
+      resY,
+      [&](size_t b, size_t e, unsigned) {
+        for (size_t y = b; y < e; ++y)
+          if (!rowData[y].empty()) std::memcpy(&compressed[prefix[y * size_t(resX)]], rowData[y].data(), rowData[y].size() * sizeof(uint32_t));
+      },
+      workers);
+
+  // Same params a mesh of this bounding box would get from the voxelizer.
+  const int maxTransitions = *std::max_element(maxPerWorker.begin(), maxPerWorker.end());
+  VoxelizationParams& params = out.params;
+  params = VoxelizationParams();
+  params.resolution = resolution;
+  params.resolutionXYZ = resXYZ;
+  storeZSubdivision(params, zSub);
+  params.center = glm::vec3(center);
+  params.scale = (float)(1.0 / std::max(size.x, size.y));
+  params.zSpan = (float)(size.z * params.scale);
+  params.maxTransitionsPerZColumn = std::max(params.maxTransitionsPerZColumn, maxTransitions);
+
+  if (stats) {
+    stats->columns = totalPixels;
+    stats->transitions = total;
+    stats->maxTransitions = maxTransitions;
+    stats->workers = used;
+    stats->ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+  }
+  return true;
+}
@@ -0,0 +1,213 @@
+#include "voxelResample.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#include "hash.hpp"
+#include "mappedFile.hpp"
+#include "resultWriter.hpp"  // writeVoxelObject
+
+#define RESAMPLE_CACHE_VERSION 3u  // bump whenever the resampling semantics change
+
+namespace {
+
+struct Run {
+  long s0, s1;  // solid slices s0..s1 (inclusive)
+};
+
+// Solid runs of every column in `cols` (source column indices), merged and sorted.
+// Transitions are sorted per column first: GPU-voxelized columns may not be.
+void gatherRuns(const VoxelObject& in, const std::vector<size_t>& cols, std::vector<uint32_t>& scratch, std::vector<Run>& runs) {
+  const size_t totalPixels = in.prefixSumData.size();
+  runs.clear();
+  for (size_t c : cols) {
+    const size_t b = in.prefixSumData[c], e = c + 1 < totalPixels ? in.prefixSumData[c + 1] : in.compressedData.size();
+    if (e - b < 2) continue;
+    scratch.assign(in.compressedData.begin() + b, in.compressedData.begin() + e);
+    std::sort(scratch.begin(), scratch.end());
+    for (size_t i = 0; i + 1 < scratch.size(); i += 2)
+      if (scratch[i + 1] > scratch[i]) runs.push_back(Run{(long)scratch[i] + 1, (long)scratch[i + 1]});
+  }
+  if (cols.size() > 1) std::sort(runs.begin(), runs.end(), [](const Run& l, const Run& r) { return l.s0 < r.s0; });
+}
+
+// Source range [lo, hi] of the columns a destination column covers along one axis
+// (empty when hi < lo). `o` is the source coordinate of the destination grid origin.
+inline void sourceRange(long q, double f, double o, long srcRes, ResampleMode mode, long& lo, long& hi) {
+  if (mode == ResampleMode::NEAREST) {
+    lo = hi = (long)std::floor(o + (q + 0.5) / f);
+  } else {
+    lo = (long)std::floor(o + q / f);
+    hi = (long)std::ceil(o + (q + 1) / f) - 1;
+  }
+  lo = std::max(lo, 0L);
+  hi = std::min(hi, srcRes - 1);
+}
+
+// Map merged source runs to destination slices and append the transitions.
+uint32_t emitColumn(const std::vector<Run>& runs, double fz, long dstResZ, ResampleMode mode, std::vector<uint32_t>& out) {
+  uint32_t count = 0;
+  long runStart = -1, runEnd = -1;
+  auto flush = [&]() {
+    if (runStart < 0) return;
+    out.push_back((uint32_t)(runStart - 1));
+    out.push_back((uint32_t)runEnd);
+    count += 2;
+  };
+  for (const Run& r : runs) {
+    // Source slice k stands for depths [k - 0.5, k + 0.5], destination slice j for [(j - 0.5) / fz, (j + 0.5) / fz].
+    long j0, j1;
+    if (mode == ResampleMode::NEAREST) {
+      j0 = (long)std::ceil((r.s0 - 0.5) * fz);
+      j1 = (long)std::ceil((r.s1 + 0.5) * fz) - 1;
+    } else {
+      j0 = (long)std::floor((r.s0 - 0.5) * fz - 0.5) + 1;
+      j1 = (long)std::ceil((r.s1 + 0.5) * fz + 0.5) - 1;
+    }
+    j0 = std::max(j0, 1L);
+    j1 = std::min(j1, dstResZ - 1);
+    if (j0 > j1) continue;
+    if (runStart >= 0 && j0 <= runEnd + 1) {
+      runEnd = std::max(runEnd, j1);
+      continue;
+    }
+    flush();
+    runStart = j0;
+    runEnd = j1;
+  }
+  flush();
+  return count;
+}
+
+}  // namespace
+
+bool parseResampleMode(const std::string& name, ResampleMode& mode) {
+  if (name == "nearest") {
+    mode = ResampleMode::NEAREST;
+  } else if (name == "conservative") {
+    mode = ResampleMode::CONSERVATIVE;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+glm::ivec3 resampledResolution(const VoxelizationParams& params, const glm::vec3& voxelSize) {
+  const glm::dvec3 f = glm::dvec3(::voxelSize(params)) / glm::dvec3(voxelSize);
+  const glm::dvec3 r = glm::dvec3(params.resolutionXYZ) * f;
+  return glm::ivec3(std::max(1, (int)std::ceil(r.x - 1e-4)), std::max(1, (int)std::ceil(r.y - 1e-4)), std::max(1, (int)std::ceil(r.z - 1e-4)));
+}
+
+void resampleVoxelObject(const VoxelObject& in, const glm::vec3& voxelSize, ResampleMode mode, VoxelObject& out, unsigned workers) {
+  const glm::ivec3 src = in.params.resolutionXYZ, dst = resampledResolution(in.params, voxelSize);
+  const glm::dvec3 f = glm::dvec3(::voxelSize(in.params)) / glm::dvec3(voxelSize);  // destination voxels per source voxel
+  // Both grids share their centre in XY and their top plane in Z.
+  const double ox = 0.5 * (src.x - dst.x / f.x), oy = 0.5 * (src.y - dst.y / f.y);
+
+  const size_t totalPixels = size_t(dst.x) * size_t(dst.y);
+  out.params = in.params;
+  out.params.resolutionXYZ = dst;
+  out.params.resolution = voxelSize.x;
+  storeZSubdivision(out.params, std::max(1, (int)std::lround(voxelSize.x / voxelSize.z)));
+  std::vector<uint32_t>& prefix = out.prefixSumData;
+  std::vector<uint32_t>& compressed = out.compressedData;
+  prefix.assign(totalPixels, 0);
+
+  // One destination row per task (counts in `prefix`, transitions per row).
+  std::vector<std::vector<uint32_t>> rowData(dst.y);
+  std::vector<int> maxPerWorker(std::max(1u, workers), 0);
+  parallelFor(
+      dst.y,
+      [&](size_t b, size_t e, unsigned w) {
+        std::vector<size_t> cols;
+        std::vector<uint32_t> scratch;
+        std::vector<Run> runs;
+        for (size_t qy = b; qy < e; ++qy) {
+          long y0, y1;
+          sourceRange((long)qy, f.y, oy, src.y, mode, y0, y1);
+          if (y1 < y0) continue;
+          uint32_t* counts = &prefix[qy * size_t(dst.x)];
+          for (long qx = 0; qx < dst.x; ++qx) {
+            long x0, x1;
+            sourceRange(qx, f.x, ox, src.x, mode, x0, x1);
+            cols.clear();
+            for (long y = y0; y <= y1; ++y)
+              for (long x = x0; x <= x1; ++x) cols.push_back(size_t(y) * src.x + x);
+            gatherRuns(in, cols, scratch, runs);
+            if (runs.empty()) continue;
+            counts[qx] = emitColumn(runs, f.z, dst.z, mode, rowData[qy]);
+            maxPerWorker[w] = std::max(maxPerWorker[w], (int)counts[qx]);
+          }
+        }
+      },
+      workers);
+
+  // Exclusive prefix sum (on all cores), then every row is copied to its final place.
+  const size_t total = parallelExclusiveScan(prefix.data(), totalPixels, workers);
+  compressed.resize(total);
+  parallelFor(
+      dst.y,
+      [&](size_t b, size_t e, unsigned) {
+        for (size_t y = b; y < e; ++y)
+          if (!rowData[y].empty()) std::memcpy(&compressed[prefix[y * size_t(dst.x)]], rowData[y].data(), rowData[y].size() * sizeof(uint32_t));
+      },
+      workers);
+  out.params.maxTransitionsPerZColumn = std::max(in.params.maxTransitionsPerZColumn, *std::max_element(maxPerWorker.begin(), maxPerWorker.end()));
+}
+
+bool loadResampledObject(const std::string& path, const glm::vec3& voxelSize, ResampleMode mode, const std::string& cacheDir, VoxelObject& out,
+                         bool* fromCache) {
+  if (fromCache) *fromCache = false;
+  try {
+    MappedFile file(path);
+    VoxelizationParams params;
+    if (!BoolOps::loadParams(path, params)) {
+      std::cerr << "Not a voxel object: " << path << std::endl;
+      return false;
+    }
+    const glm::vec3 current = ::voxelSize(params);
+    auto same = [](float a, float b) { return std::abs(a - b) <= 1e-4f * b; };
+    if (same(current.x, voxelSize.x) && same(current.y, voxelSize.y) && same(current.z, voxelSize.z))
+      return BoolOps::loadObject(path, out);  // already at that voxel size
+
+    std::string cachePath;
+    if (!cacheDir.empty()) {
+      const uint32_t version = RESAMPLE_CACHE_VERSION, modeId = (uint32_t)mode;
+      uint64_t h = fnv1a64(&version, sizeof(version));
+      h = fnv1a64(&modeId, sizeof(modeId), h);
+      h = fnv1a64(&voxelSize.x, sizeof(float), h);  // field by field: no padding bytes
+      h = fnv1a64(&voxelSize.y, sizeof(float), h);
+      h = fnv1a64(&voxelSize.z, sizeof(float), h);
+      h = fnv1a64(file.data(), file.size(), h);
+      char name[32];
+      std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)h);
+      cachePath = (std::filesystem::path(cacheDir) / name).string();
+      if (BoolOps::loadObject(cachePath, out)) {
+        if (fromCache) *fromCache = true;
+        return true;
+      }
+    }
+
+    VoxelObject source;
+    if (!BoolOps::loadObject(path, source)) {
+      std::cerr << "Failed to load voxel object: " << path << std::endl;
+      return false;
+    }
+    resampleVoxelObject(source, voxelSize, mode, out);
+
+    if (!cachePath.empty()) {
+      std::error_code ec;
+      std::filesystem::create_directories(cacheDir, ec);
+      if (ec || !writeVoxelObject(out, cachePath)) std::cerr << "Warning: could not write resampling cache " << cachePath << std::endl;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Failed to resample voxel object: " << e.what() << std::endl;
+    return false;
+  }
+  return true;
+}
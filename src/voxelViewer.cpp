@@ -15,17 +15,19 @@
 #define IDENTITY_MODEL glm::mat4(1.0f)  // Identity matrix for model transformations
 
 VoxelViewer::VoxelViewer(const std::string& compressedFile, const std::string& prefixSumFile, VoxelizationParams params) : params(params) {
+  std::vector<unsigned int> compressedData, prefixSumData;
   if (!loadBinaryFile(compressedFile, compressedData) || !loadBinaryFile(prefixSumFile, prefixSumData)) {
     throw std::runtime_error("Failed to load one or both input files");
   }
   initGL();
-  setupShaderAndBuffers();
+  setupShaderAndBuffers(compressedData, prefixSumData);
 }
 
-VoxelViewer::VoxelViewer(const std::vector<unsigned int>& compressed, const std::vector<unsigned int>& prefixSum, VoxelizationParams params)
-    : params(params), compressedData(compressed), prefixSumData(prefixSum) {
+VoxelViewer::VoxelViewer(SharedVoxelObject obj) {
+  if (!obj) throw std::runtime_error("VoxelViewer: null voxel object");
+  params = obj->params;
   initGL();
-  setupShaderAndBuffers();
+  setupShaderAndBuffers(obj->compressedData, obj->prefixSumData);
 
   // Compute distance based on actual bounding box dimensions
   float halfX = 0.5f;
@@ -117,7 +119,7 @@ void VoxelViewer::onScroll(double xoffset, double yoffset) {
   distance = glm::clamp(distance, 0.01f, 100.0f);  // Prevent negative or excessive zoom
 }
 
-void VoxelViewer::setupShaderAndBuffers() {
+void VoxelViewer::setupShaderAndBuffers(const std::vector<unsigned int>& compressedData, const std::vector<unsigned int>& prefixSumData) {
   flatShader = new Shader("shaders/gcode_flat.vert", "shaders/gcode_flat.frag");
   raymarchingShader = new Shader("shaders/raymarching.vert", "shaders/raymarching.frag");
 
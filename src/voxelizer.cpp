@@ -6,14 +6,18 @@
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <numeric>
 #include <random>
 #include <stdexcept>
 #include <thread>
 
 #include "GLUtils.hpp"
+#include "parallel.hpp"
 #include "prefixSum.hpp"
 #include "shader.hpp"
+#include "voxelizerCPU.hpp"
+#include "voxelizerUtils.hpp"
 
 #define MIN_RESOLUTION_XYZ 32  // Minimum resolution for each axis, used for very small objects
 #define DEBUG_OUTPUT           // Enable debug output for detailed information
@@ -33,6 +37,7 @@ Voxelizer::Voxelizer(const Mesh& mesh, VoxelizationParams& params) : mesh(mesh),
   glm::ivec3 res = this->calculateResolutionPx(vertices);  // Calculate resolution based on mesh vertices
   // params.resolutionXYZ = res; // Modify params passed in constructor by reference
   this->params.resolutionXYZ = res;  // Modify class member params.resolutionXYZ
+  storeZSubdivision(this->params, 1);  // cubic voxels until setZSubdivision()
 
   normalizeMesh();  // Normalize the mesh vertices
 }
@@ -45,12 +50,43 @@ void Voxelizer::setMesh(const Mesh& newMesh) {
   glm::ivec3 res = this->calculateResolutionPx(vertices);  // Calculate resolution based on mesh vertices
   // params.resolutionXYZ = res; // Modify params passed in constructor by reference
   this->params.resolutionXYZ = res;  // Modify class member params.resolutionXYZ
+  storeZSubdivision(this->params, 1);  // cubic voxels until setZSubdivision()
 
   normalizeMesh();  // Normalize the mesh vertices
 }
 
 void Voxelizer::setParams(const VoxelizationParams& newParams) { params = newParams; }
 
+void Voxelizer::setZSubdivision(int n) {
+  if (vertices.empty()) throw std::runtime_error("Cannot subdivide Z: no mesh set.");
+  const double zExtent = computeZSpan() / params.scale;  // vertices are normalized
+  storeZSubdivision(params, n);
+  params.resolutionXYZ.z = std::max(1, (int)std::ceil(zExtent * n / params.resolution - 1e-4));
+}
+
+VoxelizerGL::VoxelizerGL(int width, int height, bool visible) {
+  setupGLContext(&window, width, height, "STL Viewer", !visible);
+  draw = new Shader("shaders/vertex.glsl", "shaders/fragment.glsl");
+  transitions = new Shader("shaders/transitions_xyz2.comp");
+  countFill = new Shader("shaders/transitions_count_fill.comp");
+  compress = new Shader("shaders/compress_transitions.comp");
+  prefixPass1 = new Shader("shaders/prefix_pass1.comp");
+  prefixPass2 = new Shader("shaders/prefix_pass2.comp");
+  prefixPass3 = new Shader("shaders/prefix_pass3.comp");
+}
+
+VoxelizerGL::~VoxelizerGL() {
+  // The Shader destructor handles glDeleteProgram (the context is still current).
+  delete draw;
+  delete transitions;
+  delete countFill;
+  delete compress;
+  delete prefixPass1;
+  delete prefixPass2;
+  delete prefixPass3;
+  destroyGLContext(window);
+}
+
 std::pair<std::vector<GLuint>, std::vector<GLuint>> Voxelizer::getResults() const { return {compressedData, prefixSumData}; }
 
 void Voxelizer::clearResults() {
@@ -115,12 +151,125 @@ void Voxelizer::run() {
   float zSpan = computeZSpan();
   params.zSpan = zSpan;  // Modify params passed in constructor by reference
 
-  auto [data, prefix] = this->voxelizerZ(vertices, indices, zSpan /* * 1.05*/, params);  //%%%%%%%%%
+  if (backend == VoxelizerBackend::CPU) {
+    CpuVoxelizeStats stats;
+    voxelizeColumnsCPU(vertices, indices, zSpan, params.resolutionXYZ, compressedData, prefixSumData, &stats, workers ? workers : workerCount());
+    std::cout << "Voxelization complete (CPU, " << stats.workers << " threads, " << stats.crossings << " crossings). Execution time: "
+              << stats.ms / 1000.0 << " seconds\n";
+    return;
+  }
+
+  // Grids above the texture limit or the memory budget are voxelized in XY tiles.
+  const glm::ivec2 tile = chooseTileSize(params, backend, maxTilePx);
+  if (tile.x < params.resolutionXYZ.x || tile.y < params.resolutionXYZ.y) {
+    runTiled(zSpan, tile);
+    return;
+  }
+
+  auto [data, prefix] = backend == VoxelizerBackend::GPU_TWO_PASS ? this->voxelizerZ_twoPass(vertices, indices, zSpan, params)
+                                                                   : this->voxelizerZ(vertices, indices, zSpan /* * 1.05*/, params);  //%%%%%%%%%
 
   this->compressedData = std::move(data);
   this->prefixSumData = std::move(prefix);
 }
 
+void Voxelizer::runTiled(float zSpan, glm::ivec2 tile) {
+  const int resX = params.resolutionXYZ.x, resY = params.resolutionXYZ.y;
+  const int tilesX = (resX + tile.x - 1) / tile.x, tilesY = (resY + tile.y - 1) / tile.y;
+  std::cout << "Tiled voxelization: " << tilesX << " x " << tilesY << " tiles of " << tile.x << " x " << tile.y << " px\n";
+
+  // Tile results, in tile order (tile row by tile row). Each tile is a complete
+  // voxelization of its own sub-grid: a projection restricted to its part of the
+  // normalized XY square keeps the pixel centres of the full grid.
+  struct TileResult {
+    int x0, y0, w, h;
+    std::vector<GLuint> data, prefix;
+  };
+  std::vector<TileResult> tiles;
+  tiles.reserve(size_t(tilesX) * tilesY);
+
+  // One context and one set of programs for all the tiles.
+  std::unique_ptr<VoxelizerGL> ownGL;
+  VoxelizerGL* const previousGL = sharedGL;
+  if (!sharedGL) {
+    ownGL = std::make_unique<VoxelizerGL>(tile.x, tile.y);
+    sharedGL = ownGL.get();
+  }
+  for (int ty = 0; ty < tilesY; ++ty) {
+    for (int tx = 0; tx < tilesX; ++tx) {
+      TileResult t;
+      t.x0 = tx * tile.x;
+      t.y0 = ty * tile.y;
+      t.w = std::min(tile.x, resX - t.x0);
+      t.h = std::min(tile.y, resY - t.y0);
+      const glm::vec4 xyWindow(-0.5f + float(t.x0) / resX, -0.5f + float(t.x0 + t.w) / resX, -0.5f + float(t.y0) / resY,
+                               -0.5f + float(t.y0 + t.h) / resY);
+
+      // Only the triangles whose XY box touches the tile (one pixel of margin).
+      const float mx = 1.0f / resX, my = 1.0f / resY;
+      std::vector<unsigned int> tileIndices;
+      for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        float x0 = FLT_MAX, x1 = -FLT_MAX, y0 = FLT_MAX, y1 = -FLT_MAX;
+        for (int k = 0; k < 3; ++k) {
+          const float vx = vertices[indices[i + k] * 3], vy = vertices[indices[i + k] * 3 + 1];
+          x0 = std::min(x0, vx);
+          x1 = std::max(x1, vx);
+          y0 = std::min(y0, vy);
+          y1 = std::max(y1, vy);
+        }
+        if (x1 < xyWindow.x - mx || x0 > xyWindow.y + mx || y1 < xyWindow.z - my || y0 > xyWindow.w + my) continue;
+        tileIndices.insert(tileIndices.end(), indices.begin() + i, indices.begin() + i + 3);
+      }
+
+      VoxelizationParams tileParams = params;
+      tileParams.resolutionXYZ.x = t.w;
+      tileParams.resolutionXYZ.y = t.h;
+      tileParams.slicesPerBlock = chooseOptimalPowerOfTwoSlicesPerBlock(tileParams, backend);
+      if (tileIndices.empty()) {
+        t.prefix.assign(size_t(t.w) * t.h, 0);  // nothing to render: all columns empty
+      } else {
+        auto [data, prefix] = backend == VoxelizerBackend::GPU_TWO_PASS ? voxelizerZ_twoPass(vertices, tileIndices, zSpan, tileParams, xyWindow)
+                                                                        : voxelizerZ(vertices, tileIndices, zSpan, tileParams, xyWindow);
+        t.data = std::move(data);
+        t.prefix = std::move(prefix);
+      }
+      tiles.push_back(std::move(t));
+    }
+  }
+  sharedGL = previousGL;
+
+  // Stitch: global exclusive prefix sum over the columns in grid order, then
+  // every (row, tile) run of columns is copied to its place.
+  auto columnCount = [](const TileResult& t, size_t i) -> GLuint {
+    const size_t end = (i + 1 < t.prefix.size()) ? t.prefix[i + 1] : t.data.size();
+    return GLuint(end - t.prefix[i]);
+  };
+  prefixSumData.resize(size_t(resX) * resY);
+  size_t total = 0;
+  for (int y = 0; y < resY; ++y) {
+    for (int tx = 0; tx < tilesX; ++tx) {
+      const TileResult& t = tiles[size_t(y / tile.y) * tilesX + tx];
+      const size_t row = size_t(y - t.y0) * t.w;
+      for (int x = 0; x < t.w; ++x) {
+        prefixSumData[size_t(y) * resX + t.x0 + x] = GLuint(total);
+        total += columnCount(t, row + x);
+      }
+    }
+  }
+  compressedData.resize(total);
+  parallelFor(resY, [&](size_t b, size_t e, unsigned) {
+    for (size_t y = b; y < e; ++y) {
+      for (int tx = 0; tx < tilesX; ++tx) {
+        const TileResult& t = tiles[(y / tile.y) * tilesX + tx];
+        const size_t first = size_t(y - t.y0) * t.w;
+        const size_t begin = t.prefix[first];
+        const size_t end = (first + t.w < t.prefix.size()) ? t.prefix[first + t.w] : t.data.size();
+        if (end > begin) std::copy(t.data.begin() + begin, t.data.begin() + end, compressedData.begin() + prefixSumData[y * resX + t.x0]);
+      }
+    }
+  });
+}
+
 void Voxelizer::normalizeMesh() {
   if (vertices.empty()) {
     throw std::runtime_error("Cannot normalize: vertices are empty.");
@@ -187,6 +336,8 @@ bool Voxelizer::save(const std::string& filename) {
   std::cout << "Data size write (compressedData): " << dataSize << " bytes\n";
   std::cout << "Prefix size write (prefixSumData): " << prefixSize << " bytes\n";
 
+  const VoxelFileTag tag = voxelFileTag(params);
+  file.write(reinterpret_cast<const char*>(&tag), sizeof(VoxelFileTag));
   file.write(reinterpret_cast<const char*>(&dataSize), sizeof(size_t));
   file.write(reinterpret_cast<const char*>(&prefixSize), sizeof(size_t));
 
@@ -823,28 +974,37 @@ std::pair<std::vector<GLuint>, std::vector<GLuint>> Voxelizer::voxelizerZ_OLD(co
 }
 
 std::pair<std::vector<GLuint>, std::vector<GLuint>> Voxelizer::voxelizerZ(const std::vector<float>& vertices, const std::vector<unsigned int>& indices,
-                                                                          float zSpan, const VoxelizationParams& params) {
-  GLFWwindow* window;
-  Shader* drawShader;
-  Shader* computeShader;
+                                                                          float zSpan, const VoxelizationParams& params, const glm::vec4& xyWindow) {
   GLuint sliceTex, fbo;
   MeshBuffers meshBuffers;
 
   int triangleCount = indices.size();
 
-  // Initialize OpenGL context and create a window
-  setupGLContext(&window, params.resolutionXYZ.x, params.resolutionXYZ.y, "STL Viewer", !params.preview);
-  if (!window) throw std::runtime_error("Failed to create GLFW window");
+  // Triangles sorted by zMin: slice z only draws the prefix with zMin <= z (the
+  // rest lies entirely above its clipping plane and would be discarded anyway).
+  std::vector<unsigned int> zSortedIndices = indices;
+  const std::vector<float> zMinSorted = sortTrianglesByZMin(vertices, zSortedIndices);
+  const float clipMargin = 1e-6f * zSpan;  // never drop a triangle touching the plane
+  size_t trianglesDrawn = 0, trianglesFull = 0;
+
+  // OpenGL context and programs: the shared ones (voxelize-batch) or our own.
+  std::unique_ptr<VoxelizerGL> ownGL;
+  VoxelizerGL* gl = sharedGL;
+  if (!gl) {
+    ownGL = std::make_unique<VoxelizerGL>(params.resolutionXYZ.x, params.resolutionXYZ.y, params.preview);
+    gl = ownGL.get();
+  }
+  GLFWwindow* window = gl->window;
+  Shader* drawShader = gl->draw;
+  Shader* computeShader = gl->transitions;
 
 #ifdef DEBUG_GPU
   queryGPULimits();
 #endif
 
   // Load mesh and upload to GPU
-  meshBuffers = uploadMesh(vertices, indices);
+  meshBuffers = uploadMesh(vertices, zSortedIndices);
 
-  drawShader = new Shader("shaders/vertex.glsl", "shaders/fragment.glsl");
-  computeShader = new Shader("shaders/transitions_xyz2.comp");
 
 #ifdef GPU_LIMITS
   // ##########################################################################
@@ -926,7 +1086,7 @@ std::pair<std::vector<GLuint>, std::vector<GLuint>> Voxelizer::voxelizerZ(const
   const float farPlane = 2.0f * zSpan;  // Far plane distance, slightly beyond the zSpan (2x)
 
   // lefe, right, bottom, top represents a 1.0f x 1.0f square in the XY plane, due to the coosen normalization scale
-  glm::mat4 projection = glm::ortho(-0.5f, 0.5f, -0.5f, 0.5f, nearPlane, farPlane);  //%%%%%
+  glm::mat4 projection = glm::ortho(xyWindow.x, xyWindow.y, xyWindow.z, xyWindow.w, nearPlane, farPlane);  //%%%%%
 
   const glm::vec3 eye = glm::vec3(0, 0, zSpan / 2 + 0.1f);  // Camera position
   const glm::vec3 center = glm::vec3(0, 0, 0);              // Point to look at
@@ -974,8 +1134,11 @@ std::pair<std::vector<GLuint>, std::vector<GLuint>> Voxelizer::voxelizerZ(const
       // glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, sliceTex, 0, i); // bind texture layer for this slice
       glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
       if (zStart + i - 1 >= 0) {
+        const size_t visible = trianglesBelow(zMinSorted, z + clipMargin);
+        trianglesDrawn += visible;
+        trianglesFull += zMinSorted.size();
         glBindVertexArray(meshBuffers.vao);
-        glDrawElements(GL_TRIANGLES, triangleCount, GL_UNSIGNED_INT, 0);
+        if (visible > 0) glDrawElements(GL_TRIANGLES, (GLsizei)(3 * visible), GL_UNSIGNED_INT, 0);
       }
 
       // Visualize the slice
@@ -1030,6 +1193,8 @@ std::pair<std::vector<GLuint>, std::vector<GLuint>> Voxelizer::voxelizerZ(const
   auto endTime = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double> elapsedTime = endTime - startTime;
   std::cout << "Voxelization complete. Execution time: " << elapsedTime.count() << " seconds\n";
+  std::cout << "Triangles drawn: " << trianglesDrawn << " of " << trianglesFull << " ("
+            << (trianglesFull ? 100.0 * trianglesDrawn / trianglesFull : 0.0) << "%)\n";
 
   // ---------------------------> I HAVE A PROBLEM UP TO HERE IF THE NUMBER OF POINTS IS TOO HIGH
 
@@ -1137,9 +1302,9 @@ std::pair<std::vector<GLuint>, std::vector<GLuint>> Voxelizer::voxelizerZ(const
   glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), &zero, GL_DYNAMIC_COPY);
 
   // 3. Load or compile shaders
-  Shader* prefixPass1 = new Shader("shaders/prefix_pass1.comp");
-  Shader* prefixPass2 = new Shader("shaders/prefix_pass2.comp");
-  Shader* prefixPass3 = new Shader("shaders/prefix_pass3.comp");
+  Shader* prefixPass1 = gl->prefixPass1;
+  Shader* prefixPass2 = gl->prefixPass2;
+  Shader* prefixPass3 = gl->prefixPass3;
 
   // 4. Run prefix sum
   prefixSumMultiLevel1B(countBuffer,  //@@@ _countBuffer,
@@ -1165,7 +1330,7 @@ std::pair<std::vector<GLuint>, std::vector<GLuint>> Voxelizer::voxelizerZ(const
   // 3. Add them on the CPU to compute totalCompressedCount.
   // 4. Use that to allocate compressedBuffer.
 
-  Shader* compressTransitionsShader = new Shader("shaders/compress_transitions.comp");
+  Shader* compressTransitionsShader = gl->compress;
 
   // --- 1. Read last value from prefixSumBuffer
   GLuint lastPrefixValue = 0;
@@ -1235,16 +1400,183 @@ std::pair<std::vector<GLuint>, std::vector<GLuint>> Voxelizer::voxelizerZ(const
 
   meshBuffers = {};  // reset values
 
-  // Delete shader objects (the Shader destructor should handle glDeleteProgram)
-  delete drawShader;
-  delete computeShader;
-  delete compressTransitionsShader;
-  delete prefixPass1;
-  delete prefixPass2;
-  delete prefixPass3;
+  // Programs and context belong to `gl` (released with ownGL, if it is ours).
 
-  if (window) glfwDestroyWindow(window);
-  glfwTerminate();
+  return {compressedData, prefixSumData};
+}
+
+std::pair<std::vector<GLuint>, std::vector<GLuint>> Voxelizer::voxelizerZ_twoPass(const std::vector<float>& vertices, const std::vector<unsigned int>& indices,
+                                                                                  float zSpan, const VoxelizationParams& params, const glm::vec4& xyWindow) {
+  // Same slicing as voxelizerZ(), but the transitions are never stored in a fixed
+  // per-column slot buffer: pass 0 renders the slices and only counts the
+  // transitions of every column, an exact prefix sum sizes the output, and pass 1
+  // renders the slices again and writes every column in place, in Z order.
+  // GPU memory: one R8 slice block + counts + prefix sum + the exact output.
+  // OpenGL context and programs: the shared ones (voxelize-batch) or our own.
+  std::unique_ptr<VoxelizerGL> ownGL;
+  VoxelizerGL* gl = sharedGL;
+  if (!gl) {
+    ownGL = std::make_unique<VoxelizerGL>(params.resolutionXYZ.x, params.resolutionXYZ.y, params.preview);
+    gl = ownGL.get();
+  }
+
+  // Triangles sorted by zMin: each slice draws only the prefix below its plane.
+  std::vector<unsigned int> zSortedIndices = indices;
+  const std::vector<float> zMinSorted = sortTrianglesByZMin(vertices, zSortedIndices);
+  const float clipMargin = 1e-6f * zSpan;
+  MeshBuffers meshBuffers = uploadMesh(vertices, zSortedIndices);
+  Shader* drawShader = gl->draw;
+  Shader* countFillShader = gl->countFill;
+
+  const int resX = params.resolutionXYZ.x, resY = params.resolutionXYZ.y, resZ = params.resolutionXYZ.z;
+  const size_t totalPixels = size_t(resX) * size_t(resY);
+  const int totalBlocks = (resZ + params.slicesPerBlock - 1) / params.slicesPerBlock;
+  const float deltaZ = zSpan / resZ;
+
+#ifdef GPU_LIMITS
+  GLint maxTexSize, maxTexLayers;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxTexLayers);
+  if (resX > maxTexSize || resY > maxTexSize || params.slicesPerBlock + 1 > maxTexLayers) {
+    std::cerr << "ERROR: Texture dimensions exceed GPU limits!" << std::endl;
+  }
+#endif
+
+  // Only "inside" (red) matters per slice: one byte per texel instead of RGBA8.
+  GLuint sliceTex, fbo, depthRbo;
+  glGenTextures(1, &sliceTex);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, sliceTex);
+  glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_R8, resX, resY, params.slicesPerBlock + 1);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, sliceTex, 0, 0);
+  glDrawBuffer(GL_COLOR_ATTACHMENT0);
+  glGenRenderbuffers(1, &depthRbo);
+  glBindRenderbuffer(GL_RENDERBUFFER, depthRbo);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, resX, resY);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRbo);
+  GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    std::cerr << "Framebuffer not complete! Error code: 0x" << std::hex << status << std::dec << std::endl;
+  }
+  glViewport(0, 0, resX, resY);
+  glEnable(GL_DEPTH_TEST);
+
+  // Same camera as voxelizerZ(): top-down orthographic view of the normalized mesh.
+  const glm::mat4 projection = glm::ortho(xyWindow.x, xyWindow.y, xyWindow.z, xyWindow.w, 0.0f, 2.0f * zSpan);
+  const glm::mat4 view = glm::lookAt(glm::vec3(0, 0, zSpan / 2 + 0.1f), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+
+  // Count buffer (also the write cursor of pass 1), zeroed on the GPU.
+  GLuint countBuffer, prefixSumBuffer, blockSumsBuffer, blockOffsetsBuffer, errorFlagBuffer, compressedBuffer = 0;
+  const GLuint zero = 0;
+  glGenBuffers(1, &countBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, totalPixels * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+  glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+  glGenBuffers(1, &prefixSumBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, prefixSumBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, (totalPixels + 1) * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+  glGenBuffers(1, &blockSumsBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, blockSumsBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, div_ceil(totalPixels, WORKGROUP_SIZE) * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+  glGenBuffers(1, &blockOffsetsBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, blockOffsetsBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, div_ceil(totalPixels, WORKGROUP_SIZE) * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+  glGenBuffers(1, &errorFlagBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, errorFlagBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), &zero, GL_DYNAMIC_COPY);
+
+  // Render the slices of every block and run the count (0) or fill (1) pass on them.
+  auto slicePass = [&](int pass) {
+    for (int block = 0; block < totalBlocks; ++block) {
+      const int zStart = block * params.slicesPerBlock;
+      const int slicesThisBlock = std::min(params.slicesPerBlock, resZ - zStart);
+
+      glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+      drawShader->use();
+      drawShader->setMat4("projection", projection);
+      drawShader->setMat4("view", view);
+      drawShader->setMat4("model", glm::mat4(1.0f));
+      glBindVertexArray(meshBuffers.vao);
+      for (int i = 0; i <= slicesThisBlock; ++i) {
+        const float z = zSpan / 2.0f - (zStart + i) * deltaZ;
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, sliceTex, 0, i);
+        drawShader->setVec4("clippingPlane", glm::vec4(0, 0, -1, z));
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        const size_t visible = (zStart + i - 1 >= 0) ? trianglesBelow(zMinSorted, z + clipMargin) : 0;
+        if (visible > 0) glDrawElements(GL_TRIANGLES, (GLsizei)(3 * visible), GL_UNSIGNED_INT, 0);
+      }
+      glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+
+      countFillShader->use();
+      countFillShader->setInt("zStart", zStart);
+      countFillShader->setInt("sliceCount", slicesThisBlock);
+      countFillShader->setInt("resolutionX", resX);
+      countFillShader->setInt("resolutionY", resY);
+      countFillShader->setInt("resolutionZ", resZ);
+      countFillShader->setInt("pass", pass);
+      glBindImageTexture(0, sliceTex, 0, GL_TRUE, 0, GL_READ_ONLY, GL_R8);
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, countBuffer);
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, prefixSumBuffer);
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, pass == 1 ? compressedBuffer : prefixSumBuffer);  // unused when counting
+      glDispatchCompute((resX + 15) / 16, (resY + 15) / 16, 1);
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+  };
+
+  auto startTime = std::chrono::high_resolution_clock::now();
+
+  // Pass 0: count.
+  slicePass(0);
+
+  // Exact exclusive prefix sum of the counts; total = last prefix + last count.
+  Shader* prefixPass1 = gl->prefixPass1;
+  Shader* prefixPass2 = gl->prefixPass2;
+  Shader* prefixPass3 = gl->prefixPass3;
+  prefixSumMultiLevel1B(countBuffer, prefixSumBuffer, blockSumsBuffer, blockOffsetsBuffer, errorFlagBuffer, prefixPass1, prefixPass2, prefixPass3, totalPixels,
+                        WORKGROUP_SIZE);
+  GLuint lastPrefixValue = 0, lastCountValue = 0;
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, prefixSumBuffer);
+  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, (totalPixels - 1) * sizeof(GLuint), sizeof(GLuint), &lastPrefixValue);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer);
+  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, (totalPixels - 1) * sizeof(GLuint), sizeof(GLuint), &lastCountValue);
+  const GLuint totalCompressedCount = lastPrefixValue + lastCountValue;
+
+  // Pass 1: fill, in place, into an output of exactly the counted size.
+  glGenBuffers(1, &compressedBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, compressedBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<GLuint>(1, totalCompressedCount) * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer);
+  glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+  slicePass(1);
+  glFinish();
+
+  std::chrono::duration<double> elapsedTime = std::chrono::high_resolution_clock::now() - startTime;
+  std::cout << "Voxelization complete (two-pass, " << totalCompressedCount << " transitions, "
+            << (totalCompressedCount * sizeof(GLuint)) / (1024.0 * 1024.0) << " MB). Execution time: " << elapsedTime.count() << " seconds\n";
+
+  std::vector<GLuint> compressedData(totalCompressedCount);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, compressedBuffer);
+  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, totalCompressedCount * sizeof(GLuint), compressedData.data());
+  std::vector<GLuint> prefixSumData(totalPixels);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, prefixSumBuffer);
+  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, totalPixels * sizeof(GLuint), prefixSumData.data());
 
+  glDeleteBuffers(1, &countBuffer);
+  glDeleteBuffers(1, &prefixSumBuffer);
+  glDeleteBuffers(1, &blockSumsBuffer);
+  glDeleteBuffers(1, &blockOffsetsBuffer);
+  glDeleteBuffers(1, &errorFlagBuffer);
+  glDeleteBuffers(1, &compressedBuffer);
+  glDeleteBuffers(1, &meshBuffers.vbo);
+  glDeleteBuffers(1, &meshBuffers.ebo);
+  glDeleteVertexArrays(1, &meshBuffers.vao);
+  glDeleteTextures(1, &sliceTex);
+  glDeleteFramebuffers(1, &fbo);
+  glDeleteRenderbuffers(1, &depthRbo);
   return {compressedData, prefixSumData};
 }
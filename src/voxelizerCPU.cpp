@@ -0,0 +1,170 @@
+#include "voxelizerCPU.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Triangle in pixel space (pixel centres at integer x, y), wound counter-clockwise
+// seen from +Z; `down` keeps the original facing (clockwise = faces down).
+struct RasterTri {
+  glm::dvec3 a, b, c;
+  double area2;
+  int x0, x1, y0, y1;  // covered pixel range (inclusive)
+  bool down;
+};
+
+struct Crossing {
+  uint32_t x;
+  float z;
+  bool down;
+};
+
+// Edge function: > 0 left of a -> b (inside a counter-clockwise triangle).
+inline double edge(const glm::dvec3& a, const glm::dvec3& b, double px, double py) { return (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x); }
+
+// Top-left fill rule (y up): pixels exactly on an edge shared by two triangles
+// belong to exactly one of them, so a ray never sees a surface twice or not at all.
+inline bool topLeft(const glm::dvec3& a, const glm::dvec3& b) { return (b.y < a.y) || (b.y == a.y && b.x < a.x); }
+inline bool covers(double w, bool tl) { return w > 0.0 || (w == 0.0 && tl); }
+
+// Append the transitions of one column (crossings sorted by decreasing z).
+// Slice k (z = half - k * dz) is solid when the nearest crossing at or below it
+// faces down; slice 0 is always empty. Returns the number of transitions.
+uint32_t columnTransitions(const Crossing* c, size_t n, double half, double dz, long resZ, std::vector<uint32_t>& out) {
+  uint32_t count = 0;
+  long prev = 0;  // slices up to `prev` are decided
+  long runStart = -1, runEnd = -1;
+  auto flush = [&]() {
+    if (runStart < 0) return;
+    out.push_back((uint32_t)(runStart - 1));
+    out.push_back((uint32_t)runEnd);
+    count += 2;
+  };
+  for (size_t j = 0; j < n; ++j) {
+    // Last slice that still sees this crossing as the nearest surface below.
+    const long kmax = std::min(resZ - 1, (long)std::floor((half - c[j].z) / dz));
+    if (kmax <= prev) continue;
+    if (c[j].down) {
+      if (runStart >= 0 && runEnd == prev) {
+        runEnd = kmax;
+      } else {
+        flush();
+        runStart = prev + 1;
+        runEnd = kmax;
+      }
+    }
+    prev = kmax;
+  }
+  flush();
+  return count;
+}
+
+}  // namespace
+
+void voxelizeColumnsCPU(const std::vector<float>& vertices, const std::vector<unsigned int>& indices, float zSpan, const glm::ivec3& res,
+                        std::vector<uint32_t>& compressed, std::vector<uint32_t>& prefix, CpuVoxelizeStats* stats, unsigned workers) {
+  auto t0 = std::chrono::high_resolution_clock::now();
+  const int resX = res.x, resY = res.y;
+  const size_t totalPixels = size_t(resX) * size_t(resY);
+  const size_t triCount = indices.size() / 3;
+
+  // 1. Triangles to pixel space, counter-clockwise, with their covered range.
+  std::vector<RasterTri> tris(triCount);
+  parallelFor(
+      triCount,
+      [&](size_t b, size_t e, unsigned) {
+        for (size_t t = b; t < e; ++t) {
+          glm::dvec3 p[3];
+          for (int k = 0; k < 3; ++k) {
+            const size_t v = size_t(indices[t * 3 + k]) * 3;
+            p[k] = glm::dvec3((vertices[v] + 0.5) * resX - 0.5, (vertices[v + 1] + 0.5) * resY - 0.5, vertices[v + 2]);
+          }
+          RasterTri& r = tris[t];
+          r.area2 = edge(p[0], p[1], p[2].x, p[2].y);
+          r.down = r.area2 < 0.0;
+          if (r.down) std::swap(p[1], p[2]);
+          r.a = p[0];
+          r.b = p[1];
+          r.c = p[2];
+          r.area2 = std::abs(r.area2);
+          r.x0 = std::max(0, (int)std::ceil(std::min({p[0].x, p[1].x, p[2].x})));
+          r.x1 = std::min(resX - 1, (int)std::floor(std::max({p[0].x, p[1].x, p[2].x})));
+          r.y0 = std::max(0, (int)std::ceil(std::min({p[0].y, p[1].y, p[2].y})));
+          r.y1 = std::min(resY - 1, (int)std::floor(std::max({p[0].y, p[1].y, p[2].y})));
+          if (r.area2 == 0.0) r.y1 = r.y0 - 1;  // vertical: never seen by a Z ray
+        }
+      },
+      workers, 4096);
+
+  // 2. Bin the triangles by pixel row (CSR: rowStart[y] .. rowStart[y + 1]).
+  std::vector<uint32_t> rowStart(resY + 1, 0);
+  for (const RasterTri& r : tris)
+    for (int y = r.y0; y <= r.y1; ++y) ++rowStart[y + 1];
+  for (int y = 0; y < resY; ++y) rowStart[y + 1] += rowStart[y];
+  std::vector<uint32_t> rowTris(rowStart[resY]);
+  {
+    std::vector<uint32_t> fill(rowStart.begin(), rowStart.end() - 1);
+    for (size_t t = 0; t < triCount; ++t)
+      for (int y = tris[t].y0; y <= tris[t].y1; ++y) rowTris[fill[y]++] = (uint32_t)t;
+  }
+
+  // 3. One ray per column, row by row across all cores: counts go to `prefix`
+  //    (scanned below), transitions to a per-row buffer.
+  prefix.assign(totalPixels, 0);
+  std::vector<std::vector<uint32_t>> rowData(resY);
+  std::vector<size_t> crossingsPerWorker(std::max(1u, workers), 0);
+  const double half = zSpan / 2.0, dz = double(zSpan) / res.z;
+  const unsigned used = parallelFor(
+      resY,
+      [&](size_t b, size_t e, unsigned w) {
+        std::vector<Crossing> hits;
+        for (size_t y = b; y < e; ++y) {
+          hits.clear();
+          const double py = (double)y;
+          for (uint32_t i = rowStart[y]; i < rowStart[y + 1]; ++i) {
+            const RasterTri& r = tris[rowTris[i]];
+            const bool tlA = topLeft(r.b, r.c), tlB = topLeft(r.c, r.a), tlC = topLeft(r.a, r.b);
+            for (int x = r.x0; x <= r.x1; ++x) {
+              const double wA = edge(r.b, r.c, x, py), wB = edge(r.c, r.a, x, py), wC = edge(r.a, r.b, x, py);
+              if (!covers(wA, tlA) || !covers(wB, tlB) || !covers(wC, tlC)) continue;
+              const double z = (wA * r.a.z + wB * r.b.z + wC * r.c.z) / r.area2;
+              hits.push_back(Crossing{(uint32_t)x, (float)z, r.down});
+            }
+          }
+          crossingsPerWorker[w] += hits.size();
+          std::sort(hits.begin(), hits.end(), [](const Crossing& l, const Crossing& r) { return l.x != r.x ? l.x < r.x : l.z > r.z; });
+
+          std::vector<uint32_t>& out = rowData[y];
+          uint32_t* counts = &prefix[y * size_t(resX)];
+          for (size_t j = 0; j < hits.size();) {
+            size_t k = j;
+            while (k < hits.size() && hits[k].x == hits[j].x) ++k;
+            counts[hits[j].x] = columnTransitions(&hits[j], k - j, half, dz, res.z, out);
+            j = k;
+          }
+        }
+      },
+      workers);
+
+  // 4. Exact exclusive prefix sum (on all cores), then every row is copied to its final place.
+  const size_t total = parallelExclusiveScan(prefix.data(), totalPixels, workers);
+  compressed.resize(total);
+  parallelFor(
+      resY,
+      [&](size_t b, size_t e, unsigned) {
+        for (size_t y = b; y < e; ++y)
+          if (!rowData[y].empty()) std::memcpy(&compressed[prefix[y * size_t(resX)]], rowData[y].data(), rowData[y].size() * sizeof(uint32_t));
+      },
+      workers);
+
+  if (stats) {
+    stats->crossings = 0;
+    for (size_t c : crossingsPerWorker) stats->crossings += c;
+    stats->transitions = total;
+    stats->workers = used;
+    stats->ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+  }
+}
@@ -1,23 +1,48 @@
 #include <glad/glad.h> // This before GLFW to avoid conflicts
 #include "voxelizerUtils.hpp"
 
-size_t estimateMemoryUsageBytes(const VoxelizationParams& params) {
+#include <algorithm>
+#include <numeric>
+
+#define TWO_PASS_EST_TRANSITIONS_PER_COLUMN 4  // two-pass output is sized exactly after the count pass: typical parts, not the slot bound
+
+bool parseVoxelizerBackend(const std::string& name, VoxelizerBackend& backend) {
+    if (name == "gpu") backend = VoxelizerBackend::GPU;
+    else if (name == "twopass") backend = VoxelizerBackend::GPU_TWO_PASS;
+    else if (name == "cpu") backend = VoxelizerBackend::CPU;
+    else return false;
+    return true;
+}
+
+size_t estimateMemoryUsageBytes(const VoxelizationParams& params, VoxelizerBackend backend) {
     size_t totalPixels = size_t(params.resolutionXYZ.x) * size_t(params.resolutionXYZ.y);
 
+    if (backend == VoxelizerBackend::CPU) return 0; // no GPU memory
+    if (backend == VoxelizerBackend::GPU_TWO_PASS) {
+        // R8 slices + counts + prefix sum + the exact output (data dependent: estimated).
+        size_t sliceTexBytes = totalPixels * (params.slicesPerBlock + 1);
+        size_t outputBufferBytes = totalPixels * TWO_PASS_EST_TRANSITIONS_PER_COLUMN * sizeof(GLuint);
+        return sliceTexBytes + totalPixels * sizeof(GLuint) + (totalPixels + 1) * sizeof(GLuint) + outputBufferBytes;
+    }
+
     size_t sliceTexBytes = params.resolutionXYZ.x * params.resolutionXYZ.y * (params.slicesPerBlock + 1) * 4; // RGBA8 = 4 bytes
     size_t transitionBufferBytes = totalPixels * params.maxTransitionsPerZColumn * sizeof(GLuint);
     size_t countBufferBytes = totalPixels * sizeof(GLuint);
     size_t overflowBufferBytes = totalPixels * sizeof(GLuint);
+    // Compaction: prefix sum of the counts, then the compressed output, allocated
+    // while the slot buffer is still bound (at most every slot in use).
+    size_t prefixBufferBytes = (totalPixels + 1) * sizeof(GLuint);
+    size_t outputBufferBytes = transitionBufferBytes;
 
-    return sliceTexBytes + transitionBufferBytes + countBufferBytes + overflowBufferBytes;
+    return sliceTexBytes + transitionBufferBytes + countBufferBytes + overflowBufferBytes + prefixBufferBytes + outputBufferBytes;
 }
 
-int chooseOptimalSlicesPerBlock(const VoxelizationParams& params) {
+int chooseOptimalSlicesPerBlock(const VoxelizationParams& params, VoxelizerBackend backend) {
     int bestSlices = 1;
     for (int testSlices = 1; testSlices <= std::min(128, params.resolutionXYZ.z); ++testSlices) {
         VoxelizationParams testParams = params;
         testParams.slicesPerBlock = testSlices;
-        size_t mem = estimateMemoryUsageBytes(testParams);
+        size_t mem = estimateMemoryUsageBytes(testParams, backend);
         if (mem < params.maxMemoryBudgetBytes) {
             bestSlices = testSlices;
         } else {
@@ -27,12 +52,12 @@ int chooseOptimalSlicesPerBlock(const VoxelizationParams& params) {
     return bestSlices;
 }
 
-int chooseOptimalPowerOfTwoSlicesPerBlock(const VoxelizationParams& params) {
+int chooseOptimalPowerOfTwoSlicesPerBlock(const VoxelizationParams& params, VoxelizerBackend backend) {
     int bestSlices = 1;
     for (int testSlices = 1; testSlices <= std::min(128, params.resolutionXYZ.z); testSlices *= 2) {
         VoxelizationParams testParams = params;
         testParams.slicesPerBlock = testSlices;
-        size_t mem = estimateMemoryUsageBytes(testParams);
+        size_t mem = estimateMemoryUsageBytes(testParams, backend);
         if (mem < params.maxMemoryBudgetBytes) {
             bestSlices = testSlices;
         } else {
@@ -40,4 +65,42 @@ int chooseOptimalPowerOfTwoSlicesPerBlock(const VoxelizationParams& params) {
         }
     }
     return bestSlices;
-}
\ No newline at end of file
+}
+glm::ivec2 chooseTileSize(const VoxelizationParams& params, VoxelizerBackend backend, int maxTilePx) {
+    glm::ivec2 tile(std::min(params.resolutionXYZ.x, maxTilePx), std::min(params.resolutionXYZ.y, maxTilePx));
+    VoxelizationParams testParams = params;
+    testParams.slicesPerBlock = 1;
+    while (tile.x > 64 || tile.y > 64) {
+        testParams.resolutionXYZ.x = tile.x;
+        testParams.resolutionXYZ.y = tile.y;
+        if (estimateMemoryUsageBytes(testParams, backend) < params.maxMemoryBudgetBytes) break;
+        if (tile.x >= tile.y) tile.x = (tile.x + 1) / 2;
+        else tile.y = (tile.y + 1) / 2;
+    }
+    return tile;
+}
+
+std::vector<float> sortTrianglesByZMin(const std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+    const size_t triangles = indices.size() / 3;
+    std::vector<float> zMin(triangles);
+    for (size_t t = 0; t < triangles; ++t) {
+        zMin[t] = std::min({vertices[indices[3 * t] * 3 + 2], vertices[indices[3 * t + 1] * 3 + 2], vertices[indices[3 * t + 2] * 3 + 2]});
+    }
+
+    std::vector<unsigned int> order(triangles);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return zMin[a] < zMin[b]; });
+
+    std::vector<unsigned int> sortedIndices(indices.size());
+    std::vector<float> sortedZMin(triangles);
+    for (size_t t = 0; t < triangles; ++t) {
+        for (int k = 0; k < 3; ++k) sortedIndices[3 * t + k] = indices[3 * order[t] + k];
+        sortedZMin[t] = zMin[order[t]];
+    }
+    indices.swap(sortedIndices);
+    return sortedZMin;
+}
+
+size_t trianglesBelow(const std::vector<float>& zMinSorted, float z) {
+    return std::upper_bound(zMinSorted.begin(), zMinSorted.end(), z) - zMinSorted.begin();
+}